@@ -0,0 +1,619 @@
+/* Library Management System
+ * Implementation of the flat library catalog, its snapshot file
+ * and the CSV reader that produces its input.
+ * */
+
+#include "catalog.hh"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+using namespace std;
+
+namespace
+{
+    // Reservation counts are stored as int32_t in the image and used
+    // as atomics in place.
+    static_assert(sizeof(atomic<int32_t>) == sizeof(int32_t) &&
+                      atomic<int32_t>::is_always_lock_free,
+                  "atomic<int32_t> must have the layout of int32_t");
+
+    // Bump the version whenever the image layout changes.
+    const char snapshot_magic[8] = {'L', 'I', 'B', 'S', 'N', 'A', 'P', '\0'};
+    const uint32_t snapshot_version = 2;
+
+    // First bytes of every catalog image. The arrays follow the header
+    // in the order of Layout, each aligned to 8 bytes.
+    struct ImageHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t header_size;
+        uint64_t image_size;
+        uint64_t checksum;
+        uint64_t source_size;
+        int64_t source_modified_ns;
+        uint32_t string_count;
+        uint32_t library_count;
+        uint32_t author_count;
+        uint32_t book_count;
+        uint64_t string_data_size;
+    };
+
+    // Byte offsets of the arrays inside an image.
+    struct Layout
+    {
+        size_t string_offsets;
+        size_t library_name_ids;
+        size_t library_author_offsets;
+        size_t author_name_ids;
+        size_t author_book_offsets;
+        size_t book_title_ids;
+        size_t book_reservations;
+        size_t title_order;
+        size_t string_data;
+        size_t total;
+    };
+
+    size_t align8(size_t size)
+    {
+        return (size + 7) & ~static_cast<size_t>(7);
+    }
+
+    Layout layout_of(const ImageHeader &header)
+    {
+        Layout layout;
+        size_t position = align8(sizeof(ImageHeader));
+        auto place = [&position](size_t bytes)
+        {
+            size_t start = position;
+            position = align8(position + bytes);
+            return start;
+        };
+        layout.string_offsets = place((header.string_count + 1ull) * sizeof(uint64_t));
+        layout.library_name_ids = place(header.library_count * sizeof(uint32_t));
+        layout.library_author_offsets = place((header.library_count + 1ull) * sizeof(uint32_t));
+        layout.author_name_ids = place(header.author_count * sizeof(uint32_t));
+        layout.author_book_offsets = place((header.author_count + 1ull) * sizeof(uint32_t));
+        layout.book_title_ids = place(header.book_count * sizeof(uint32_t));
+        layout.book_reservations = place(header.book_count * sizeof(int32_t));
+        layout.title_order = place(header.book_count * sizeof(uint32_t));
+        layout.string_data = place(header.string_data_size);
+        layout.total = position;
+        return layout;
+    }
+
+    uint64_t image_checksum(const char *image, size_t size)
+    {
+        // FNV-1a over everything after the header
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = align8(sizeof(ImageHeader)); i < size; i++)
+        {
+            hash ^= static_cast<unsigned char>(image[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+bool read_holdings(istream &input, vector<Holding> &holdings)
+{
+    /*
+     * Function: read_holdings
+     * Parameters: istream& input, vector<Holding>& holdings
+     * Purpose: Reads library data line by line and appends one holding
+     * per line. Prints an error message and returns false on the first
+     * malformed line.
+     */
+    string line;
+    while (getline(input, line))
+    {
+        stringstream ss(line);
+        Holding holding;
+        string reservations_str;
+
+        // Read and process input based on the delimiter (; or ,)
+        if (line.find(';') != string::npos)
+        {
+            getline(ss, holding.library, ';');
+            getline(ss, holding.author, ';');
+            getline(ss, holding.title, ';');
+            getline(ss, reservations_str, ';');
+        }
+        else if (line.find(',') != string::npos)
+        {
+            getline(ss, holding.library, ',');
+            getline(ss, holding.author, ',');
+            getline(ss, holding.title, ',');
+            getline(ss, reservations_str, ',');
+        }
+        else
+        {
+            cout << "Error: unknown delimiter" << endl;
+            return false;
+        }
+
+        // Check for empty fields
+        if (holding.library.empty() || holding.author.empty() ||
+            holding.title.empty() || reservations_str.empty())
+        {
+            cout << "Error: empty field" << endl;
+            return false;
+        }
+
+        // Convert reservations_str to an integer
+        holding.reservations = (reservations_str == "on-the-shelf") ? 0 : stoi(reservations_str);
+        holdings.push_back(move(holding));
+    }
+    return true;
+}
+
+bool read_source_stamp(const string &file_name, SourceStamp &stamp)
+{
+    /*
+     * Function: read_source_stamp
+     * Parameters: const string& file_name, SourceStamp& stamp
+     * Purpose: Reads the size and modification time of a file.
+     */
+    struct stat info;
+    if (stat(file_name.c_str(), &info) != 0)
+    {
+        return false;
+    }
+    stamp.size = static_cast<uint64_t>(info.st_size);
+    stamp.modified_ns = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    return true;
+}
+
+Catalog::Catalog(const vector<Holding> &holdings)
+{
+    /*
+     * Function: Catalog::Catalog
+     * Parameters: const vector<Holding>& holdings
+     * Purpose: Interns all strings into a sorted string table and lays
+     * the holdings out as library, author and book arrays.
+     */
+
+    vector<uint64_t> string_offsets;
+    vector<uint32_t> library_name_ids, library_author_offsets;
+    vector<uint32_t> author_name_ids, author_book_offsets;
+    vector<uint32_t> book_title_ids;
+    vector<int32_t> book_reservations;
+    uint64_t string_data_size = 0;
+
+    // Intern every distinct string. Sorting the table makes id order
+    // equal to string order, which the std::map based layout relied on.
+    // Rows first get ids in order of appearance and are renumbered once
+    // the distinct strings are sorted.
+    struct Row
+    {
+        uint32_t library;
+        uint32_t author;
+        uint32_t title;
+        int32_t reservations;
+    };
+    unordered_map<string_view, uint32_t> first_seen;
+    vector<string_view> strings;
+    auto intern = [&](const string &text)
+    {
+        auto result = first_seen.emplace(text, static_cast<uint32_t>(strings.size()));
+        if (result.second)
+        {
+            strings.push_back(text);
+        }
+        return result.first->second;
+    };
+    vector<Row> rows;
+    rows.reserve(holdings.size());
+    for (const Holding &holding : holdings)
+    {
+        rows.push_back({intern(holding.library), intern(holding.author),
+                        intern(holding.title), holding.reservations});
+    }
+
+    vector<uint32_t> order(strings.size());
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+    {
+        return strings[a] < strings[b];
+    });
+
+    vector<uint32_t> sorted_id(strings.size());
+    string_offsets.reserve(strings.size() + 1);
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        sorted_id[order[i]] = i;
+        string_offsets.push_back(string_data_size);
+        string_data_size += strings[order[i]].size();
+    }
+    string_offsets.push_back(string_data_size);
+
+    for (Row &row : rows)
+    {
+        row.library = sorted_id[row.library];
+        row.author = sorted_id[row.author];
+        row.title = sorted_id[row.title];
+    }
+
+    // Group by library and author. The sort is stable so books of one
+    // author stay in input order.
+    stable_sort(rows.begin(), rows.end(), [](const Row &a, const Row &b)
+    {
+        if (a.library == b.library)
+        {
+            return a.author < b.author;
+        }
+        return a.library < b.library;
+    });
+
+    book_title_ids.reserve(rows.size());
+    book_reservations.reserve(rows.size());
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        const Row &row = rows[i];
+        bool new_library = i == 0 || rows[i - 1].library != row.library;
+        bool new_author = new_library || rows[i - 1].author != row.author;
+
+        if (new_library)
+        {
+            library_name_ids.push_back(row.library);
+            library_author_offsets.push_back(static_cast<uint32_t>(author_name_ids.size()));
+        }
+        if (new_author)
+        {
+            author_name_ids.push_back(row.author);
+            author_book_offsets.push_back(static_cast<uint32_t>(book_title_ids.size()));
+        }
+        book_title_ids.push_back(row.title);
+        book_reservations.push_back(row.reservations);
+    }
+    library_author_offsets.push_back(static_cast<uint32_t>(author_name_ids.size()));
+    author_book_offsets.push_back(static_cast<uint32_t>(book_title_ids.size()));
+
+    // Books of every author entry once more, this time by title. Summary
+    // walks this order instead of sorting on every call.
+    vector<uint32_t> title_order(book_title_ids.size());
+    for (uint32_t book = 0; book < title_order.size(); book++)
+    {
+        title_order[book] = book;
+    }
+    for (size_t author = 0; author + 1 < author_book_offsets.size(); author++)
+    {
+        stable_sort(title_order.begin() + author_book_offsets[author],
+                    title_order.begin() + author_book_offsets[author + 1],
+                    [&book_title_ids](uint32_t a, uint32_t b)
+        {
+            return book_title_ids[a] < book_title_ids[b];
+        });
+    }
+
+    // Copy the arrays into one image
+    ImageHeader header = {};
+    memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.version = snapshot_version;
+    header.header_size = sizeof(ImageHeader);
+    header.string_count = static_cast<uint32_t>(strings.size());
+    header.library_count = static_cast<uint32_t>(library_name_ids.size());
+    header.author_count = static_cast<uint32_t>(author_name_ids.size());
+    header.book_count = static_cast<uint32_t>(book_title_ids.size());
+    header.string_data_size = string_data_size;
+    Layout layout = layout_of(header);
+    header.image_size = layout.total;
+
+    auto buffer = make_shared<vector<uint64_t>>(layout.total / sizeof(uint64_t));
+    char *image = reinterpret_cast<char *>(buffer->data());
+    auto copy = [image](size_t offset, const auto &values)
+    {
+        if (!values.empty())
+        {
+            memcpy(image + offset, values.data(), values.size() * sizeof(values[0]));
+        }
+    };
+    memcpy(image, &header, sizeof(header));
+    copy(layout.string_offsets, string_offsets);
+    copy(layout.library_name_ids, library_name_ids);
+    copy(layout.library_author_offsets, library_author_offsets);
+    copy(layout.author_name_ids, author_name_ids);
+    copy(layout.author_book_offsets, author_book_offsets);
+    copy(layout.book_title_ids, book_title_ids);
+    copy(layout.book_reservations, book_reservations);
+    copy(layout.title_order, title_order);
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        const string_view &text = strings[order[i]];
+        memcpy(image + layout.string_data + string_offsets[i], text.data(), text.size());
+    }
+
+    attach(shared_ptr<const char>(buffer, image), layout.total);
+}
+
+bool Catalog::write_snapshot(const string &file_name, const SourceStamp &source) const
+{
+    /*
+     * Function: Catalog::write_snapshot
+     * Parameters: const string& file_name, const SourceStamp& source
+     * Purpose: Writes the image with the source stamp and a checksum.
+     * The file is written under a temporary name and renamed, so a
+     * reader never maps a half written snapshot.
+     */
+    if (!image_)
+    {
+        return false;
+    }
+
+    ImageHeader header;
+    memcpy(&header, image_.get(), sizeof(header));
+    header.source_size = source.size;
+    header.source_modified_ns = source.modified_ns;
+    header.checksum = image_checksum(image_.get(), image_size_);
+
+    string temporary_name = file_name + ".tmp";
+    ofstream file(temporary_name, ios::binary | ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(image_.get() + sizeof(header), image_size_ - sizeof(header));
+    file.close();
+    if (!file || rename(temporary_name.c_str(), file_name.c_str()) != 0)
+    {
+        remove(temporary_name.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Catalog::open_snapshot(const string &file_name, const SourceStamp &source)
+{
+    /*
+     * Function: Catalog::open_snapshot
+     * Parameters: const string& file_name, const SourceStamp& source
+     * Purpose: Maps a snapshot file copy-on-write and points the
+     * catalog into it. Nothing is copied or parsed; only the checksum
+     * pass touches the pages before the first query. Changed
+     * reservation counts copy their page and never reach the file.
+     */
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(ImageHeader))
+    {
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+    shared_ptr<const char> image(static_cast<const char *>(mapping), [size](const char *data)
+    {
+        munmap(const_cast<char *>(data), size);
+    });
+
+    ImageHeader header;
+    memcpy(&header, image.get(), sizeof(header));
+    if (header.source_size != source.size || header.source_modified_ns != source.modified_ns ||
+        header.checksum != image_checksum(image.get(), size))
+    {
+        return false;
+    }
+    return attach(image, size);
+}
+
+bool Catalog::attach(shared_ptr<const char> image, size_t size)
+{
+    /*
+     * Function: Catalog::attach
+     * Parameters: shared_ptr<const char> image, size_t size
+     * Purpose: Checks the image header and points the arrays into the
+     * image. The catalog keeps the image alive. The image must be
+     * writable, as the reservation counts are changed in it.
+     */
+    ImageHeader header;
+    memcpy(&header, image.get(), sizeof(header));
+    if (memcmp(header.magic, snapshot_magic, sizeof(header.magic)) != 0 ||
+        header.version != snapshot_version || header.header_size != sizeof(ImageHeader) ||
+        header.image_size != size)
+    {
+        return false;
+    }
+    Layout layout = layout_of(header);
+    if (layout.total != size)
+    {
+        return false;
+    }
+
+    const char *data = image.get();
+    string_count_ = header.string_count;
+    library_count_ = header.library_count;
+    author_count_ = header.author_count;
+    book_count_ = header.book_count;
+    string_data_ = data + layout.string_data;
+    string_offsets_ = reinterpret_cast<const uint64_t *>(data + layout.string_offsets);
+    library_name_ids_ = reinterpret_cast<const uint32_t *>(data + layout.library_name_ids);
+    library_author_offsets_ = reinterpret_cast<const uint32_t *>(data + layout.library_author_offsets);
+    author_name_ids_ = reinterpret_cast<const uint32_t *>(data + layout.author_name_ids);
+    author_book_offsets_ = reinterpret_cast<const uint32_t *>(data + layout.author_book_offsets);
+    book_title_ids_ = reinterpret_cast<const uint32_t *>(data + layout.book_title_ids);
+    title_order_ = reinterpret_cast<const uint32_t *>(data + layout.title_order);
+
+    // The counts are updated in place in the image, which is private
+    // to this process. Copies share them just like they share the image.
+    book_reservations_ = reinterpret_cast<atomic<int32_t> *>(
+        const_cast<char *>(data) + layout.book_reservations);
+    image_ = move(image);
+    image_size_ = size;
+    return true;
+}
+
+
+uint32_t Catalog::find_string(string_view text) const
+{
+    /*
+     * Function: Catalog::find_string
+     * Parameters: string_view text
+     * Purpose: Binary searches the string table and returns the id of
+     * the given text, or npos if the text does not occur in the catalog.
+     */
+    uint32_t low = 0;
+    uint32_t high = string_count_;
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        if (string_at(middle) < text)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    if (low < string_count_ && string_at(low) == text)
+    {
+        return low;
+    }
+    return npos;
+}
+
+string_view Catalog::string_at(uint32_t id) const
+{
+    return string_view(string_data_ + string_offsets_[id],
+                       static_cast<size_t>(string_offsets_[id + 1] - string_offsets_[id]));
+}
+
+uint32_t Catalog::library_count() const
+{
+    return library_count_;
+}
+
+uint32_t Catalog::find_library(string_view name) const
+{
+    uint32_t id = find_string(name);
+    const uint32_t *last = library_name_ids_ + library_count_;
+    const uint32_t *iter = lower_bound(library_name_ids_, last, id);
+    if (id == npos || iter == last || *iter != id)
+    {
+        return npos;
+    }
+    return static_cast<uint32_t>(iter - library_name_ids_);
+}
+
+string_view Catalog::library_name(uint32_t library) const
+{
+    return string_at(library_name_ids_[library]);
+}
+
+uint32_t Catalog::authors_begin(uint32_t library) const
+{
+    return library_author_offsets_[library];
+}
+
+uint32_t Catalog::authors_end(uint32_t library) const
+{
+    return library_author_offsets_[library + 1];
+}
+
+uint32_t Catalog::find_author(uint32_t library, uint32_t author_id) const
+{
+    const uint32_t *first = author_name_ids_ + authors_begin(library);
+    const uint32_t *last = author_name_ids_ + authors_end(library);
+    const uint32_t *iter = lower_bound(first, last, author_id);
+    if (author_id == npos || iter == last || *iter != author_id)
+    {
+        return npos;
+    }
+    return static_cast<uint32_t>(iter - author_name_ids_);
+}
+
+uint32_t Catalog::author_count() const
+{
+    return author_count_;
+}
+
+uint32_t Catalog::author_id(uint32_t author) const
+{
+    return author_name_ids_[author];
+}
+
+uint32_t Catalog::books_begin(uint32_t author) const
+{
+    return author_book_offsets_[author];
+}
+
+uint32_t Catalog::books_end(uint32_t author) const
+{
+    return author_book_offsets_[author + 1];
+}
+
+uint32_t Catalog::title_id(uint32_t book) const
+{
+    return book_title_ids_[book];
+}
+
+uint32_t Catalog::book_by_title(uint32_t position) const
+{
+    return title_order_[position];
+}
+
+uint32_t Catalog::book_count() const
+{
+    return book_count_;
+}
+
+int Catalog::reservations(uint32_t book) const
+{
+    return book_reservations_[book].load(memory_order_relaxed);
+}
+
+uint32_t Catalog::change_reservations(uint32_t author, uint32_t title, int delta)
+{
+    /*
+     * Function: Catalog::change_reservations
+     * Parameters: uint32_t author, uint32_t title, int delta
+     * Purpose: Changes the reservations of one copy of a book with a
+     * compare-and-swap loop, so concurrent changes never get lost. A
+     * count of 100 marks a copy that cannot be reserved, so such copies
+     * are never changed and no other count reaches 100.
+     */
+    for (uint32_t book = books_begin(author); book < books_end(author); book++)
+    {
+        if (title_id(book) != title)
+        {
+            continue;
+        }
+        int32_t current = book_reservations_[book].load(memory_order_relaxed);
+        while (current != 100 && current + delta >= 0 && current + delta < 100)
+        {
+            if (book_reservations_[book].compare_exchange_weak(current, current + delta,
+                                                               memory_order_relaxed))
+            {
+                return book;
+            }
+        }
+    }
+    return npos;
+}
+
+void Catalog::add_reservations(uint32_t book, int delta)
+{
+    book_reservations_[book].fetch_add(delta, memory_order_relaxed);
+}
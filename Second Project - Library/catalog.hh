@@ -0,0 +1,145 @@
+/* Library Management System
+ * The purpose of this header file is to define the interface
+ * for the flat library catalog. The catalog keeps every library,
+ * author and book in contiguous sorted arrays instead of nested
+ * maps, so that queries walk memory linearly.
+ * */
+
+#ifndef CATALOG_HH
+#define CATALOG_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One row of the input file: a single book held by a single library.
+struct Holding
+{
+    std::string library;
+    std::string author;
+    std::string title;
+    int reservations = 0;
+};
+
+// Identifies one version of a source file. A snapshot is only used
+// while the stamp stored in it matches the current source file.
+struct SourceStamp
+{
+    std::uint64_t size = 0;
+    std::int64_t modified_ns = 0;
+};
+
+// Declare a function for reading holdings from a CSV stream. Prints an
+// error message and returns false if the input is malformed.
+bool read_holdings(std::istream &input, std::vector<Holding> &holdings);
+
+// Declare a function for reading the stamp of a file. Returns false if
+// the file does not exist.
+bool read_source_stamp(const std::string &file_name, SourceStamp &stamp);
+
+// Read-only library catalog stored as a struct of arrays.
+//
+// All library names, authors and titles are interned into one string
+// table that is sorted lexicographically, so comparing two string ids
+// gives the same order as comparing the strings themselves. Libraries
+// own a contiguous range of author entries and every author entry owns
+// a contiguous range of books, both described by offset arrays.
+//
+// All arrays live in one contiguous image that has the same layout in
+// memory and in a snapshot file, so a snapshot is used by mapping the
+// file and pointing the arrays into it. Copies share the image.
+//
+// Reservation counts are the only mutable part. They are changed in
+// place in the image as atomics, so reserving and returning never block
+// threads that are reading the catalog at the same time. A snapshot is
+// mapped copy-on-write, so changes never reach the snapshot file.
+class Catalog
+{
+public:
+    // Returned by the lookup functions when nothing is found.
+    static const std::uint32_t npos = UINT32_MAX;
+
+    Catalog() = default;
+
+    // Builds the catalog. Libraries and authors are ordered by name and
+    // books of one author keep the order in which they were read.
+    explicit Catalog(const std::vector<Holding> &holdings);
+
+    // Writes the catalog image to a snapshot file together with the
+    // stamp of the source it was built from. The current reservation
+    // counts are written, so write it before any reservation changes.
+    // Returns false on failure.
+    bool write_snapshot(const std::string &file_name, const SourceStamp &source) const;
+
+    // Maps a snapshot file. Returns false and leaves the catalog
+    // untouched if the file is missing, corrupt, of another version or
+    // built from a different source.
+    bool open_snapshot(const std::string &file_name, const SourceStamp &source);
+
+    // Interned string table.
+    std::uint32_t find_string(std::string_view text) const;
+    std::string_view string_at(std::uint32_t id) const;
+
+    // Libraries, in name order.
+    std::uint32_t library_count() const;
+    std::uint32_t find_library(std::string_view name) const;
+    std::string_view library_name(std::uint32_t library) const;
+
+    // Author entries of a library, in name order.
+    std::uint32_t authors_begin(std::uint32_t library) const;
+    std::uint32_t authors_end(std::uint32_t library) const;
+    std::uint32_t find_author(std::uint32_t library, std::uint32_t author_id) const;
+    std::uint32_t author_count() const;
+    std::uint32_t author_id(std::uint32_t author) const;
+
+    // Books of an author entry. book_by_title maps the positions of the
+    // same range to the books ordered by title.
+    std::uint32_t books_begin(std::uint32_t author) const;
+    std::uint32_t books_end(std::uint32_t author) const;
+    std::uint32_t book_by_title(std::uint32_t position) const;
+    std::uint32_t book_count() const;
+    std::uint32_t title_id(std::uint32_t book) const;
+    int reservations(std::uint32_t book) const;
+
+    // Adds delta to the first book of the author entry with the given
+    // title whose reservations stay between 0 and 99. Books with 100
+    // reservations are not reservable and never change. Returns the
+    // changed book, or npos if no book could be changed.
+    std::uint32_t change_reservations(std::uint32_t author, std::uint32_t title, int delta);
+
+    // Adds delta to the reservations of a book without any checks.
+    void add_reservations(std::uint32_t book, int delta);
+
+private:
+    // Points the arrays into the given image. Returns false if the
+    // image is not a well-formed catalog.
+    bool attach(std::shared_ptr<const char> image, std::size_t size);
+
+    std::shared_ptr<const char> image_;
+    std::size_t image_size_ = 0;
+
+    std::uint32_t string_count_ = 0;
+    std::uint32_t library_count_ = 0;
+    std::uint32_t author_count_ = 0;
+    std::uint32_t book_count_ = 0;
+
+    const char *string_data_ = nullptr;
+    const std::uint64_t *string_offsets_ = nullptr;
+
+    const std::uint32_t *library_name_ids_ = nullptr;
+    const std::uint32_t *library_author_offsets_ = nullptr;
+
+    const std::uint32_t *author_name_ids_ = nullptr;
+    const std::uint32_t *author_book_offsets_ = nullptr;
+
+    const std::uint32_t *book_title_ids_ = nullptr;
+    const std::uint32_t *title_order_ = nullptr;
+    std::atomic<std::int32_t> *book_reservations_ = nullptr;
+};
+
+#endif // CATALOG_HH
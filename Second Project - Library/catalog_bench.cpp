@@ -0,0 +1,424 @@
+/* Library Management System
+ * Benchmark that compares the flat catalog with the nested std::map
+ * layout the program used before. Both layouts are filled with the
+ * same synthetic holdings and every command is run against both,
+ * writing into an in-memory output buffer, so the layout column
+ * compares the data layouts alone. The map layout also runs twice
+ * against /dev/null: once printing line by line to cout like the
+ * original program, so every endl costs a write(2), and once through
+ * an output buffer on the same descriptor. The output column is the
+ * gain of the output buffer alone, system calls included. All outputs
+ * are checked to be identical. With --input the holdings are read
+ * from a library input file instead, for example one written by
+ * generate_catalog, so the original output can be checked on any data.
+ *
+ * Usage: catalog_bench [rows] [libraries] [authors]
+ *        catalog_bench --input <input file>
+ * */
+
+#include "catalog.hh"
+#include "commands.hh"
+#include "synthetic.hh"
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+namespace legacy
+{
+    // The original nested layout: library -> author -> books.
+    struct Book
+    {
+        string author;
+        string title;
+        int reservations = 0;
+    };
+    using Libraries = map<string, map<string, vector<Book>>>;
+
+    // The original program ended every line with endl. Written to the
+    // output buffer it becomes a plain newline, so the two layouts can
+    // be compared through the same sink.
+    struct Newline
+    {
+    };
+    const Newline newline;
+
+    ostream &operator<<(ostream &out, Newline)
+    {
+        return out << endl;
+    }
+
+    Output &operator<<(Output &out, Newline)
+    {
+        return out << '\n';
+    }
+
+    template <typename Sink>
+    void print_libraries(const Libraries &libraries, Sink &out)
+    {
+        for (const auto &library : libraries)
+        {
+            out << library.first << newline;
+        }
+    }
+
+    template <typename Sink>
+    void print_material(const string &library_name, const Libraries &libraries, Sink &out)
+    {
+        auto library_iter = libraries.find(library_name);
+        if (library_iter != libraries.end())
+        {
+            for (const auto &author : library_iter->second)
+            {
+                for (const auto &book : author.second)
+                {
+                    out << author.first << ": " << book.title << newline;
+                }
+            }
+        }
+        else
+        {
+            out << "Error: unknown library" << newline;
+        }
+    }
+
+    template <typename Sink>
+    void print_books(const string &library_name, const string &author, const Libraries &libraries,
+                     Sink &out)
+    {
+        auto library_iter = libraries.find(library_name);
+        if (library_iter != libraries.end())
+        {
+            auto author_iter = library_iter->second.find(author);
+            if (author_iter != library_iter->second.end())
+            {
+                for (const auto &book : author_iter->second)
+                {
+                    out << book.title << " --- ";
+                    if (book.reservations == 0)
+                    {
+                        out << "on the shelf" << newline;
+                    }
+                    else
+                    {
+                        out << book.reservations << " reservations" << newline;
+                    }
+                }
+            }
+            else
+            {
+                out << "Error: unknown author" << newline;
+            }
+        }
+        else
+        {
+            out << "Error: unknown library" << newline;
+        }
+    }
+
+    template <typename Sink>
+    void print_reservable(const string &author, const string &title, const Libraries &libraries,
+                          Sink &out)
+    {
+        int min_reservations = numeric_limits<int>::max();
+        vector<string> library_names;
+        bool book_found = false;
+
+        for (const auto &library : libraries)
+        {
+            auto author_iter = library.second.find(author);
+            if (author_iter != library.second.end())
+            {
+                for (const auto &book : author_iter->second)
+                {
+                    if (book.title == title)
+                    {
+                        book_found = true;
+                        if (book.reservations < min_reservations &&
+                            book.reservations != 100)
+                        {
+                            min_reservations = book.reservations;
+                            library_names.clear();
+                            library_names.push_back(library.first);
+                        }
+                        else if (book.reservations == min_reservations)
+                        {
+                            library_names.push_back(library.first);
+                        }
+                    }
+                }
+            }
+        }
+
+        if (!book_found)
+        {
+            out << "Book is not a library book" << newline;
+        }
+        else if (min_reservations == 100)
+        {
+            out << "Book is not reservable from any library" << newline;
+        }
+        else if (min_reservations == numeric_limits<int>::max())
+        {
+            out << "Book is not reservable from any library" << newline;
+        }
+        else if (min_reservations == 0)
+        {
+            out << "on the shelf" << newline;
+            for (const auto &library_name : library_names)
+            {
+                out << "--- " << library_name << newline;
+            }
+        }
+        else
+        {
+            out << min_reservations << " reservations" << newline;
+            for (const auto &library_name : library_names)
+            {
+                out << "--- " << library_name << newline;
+            }
+        }
+    }
+
+    template <typename Sink>
+    void print_loanable(const Libraries &libraries, Sink &out)
+    {
+        map<string, set<string>> loanable_books;
+        for (const auto &library : libraries)
+        {
+            for (const auto &author : library.second)
+            {
+                for (const auto &book : author.second)
+                {
+                    if (book.reservations == 0)
+                    {
+                        loanable_books[author.first].insert(book.title);
+                    }
+                }
+            }
+        }
+
+        for (const auto &author : loanable_books)
+        {
+            for (const auto &title : author.second)
+            {
+                out << author.first << ": " << title << newline;
+            }
+        }
+    }
+}
+
+vector<Holding> generate_holdings(size_t rows, size_t libraries, size_t authors)
+{
+    /*
+     * Function: generate_holdings
+     * Parameters: size_t rows, size_t libraries, size_t authors
+     * Purpose: Creates reproducible synthetic holdings with the input
+     * file generator and reads them back with the program's own reader.
+     */
+    GeneratorOptions options;
+    options.rows = rows;
+    options.libraries = static_cast<uint32_t>(libraries);
+    options.authors = static_cast<uint32_t>(authors);
+    stringstream input;
+    generate_catalog(options, input);
+
+    vector<Holding> holdings;
+    read_holdings(input, holdings);
+    return holdings;
+}
+
+double measure(const function<void()> &action, string &output)
+{
+    /*
+     * Function: measure
+     * Parameters: const function<void()>& action, string& output
+     * Purpose: Runs the action with cout captured, stores what it
+     * printed and returns the elapsed time in milliseconds.
+     */
+    ostringstream captured;
+    streambuf *original = cout.rdbuf(captured.rdbuf());
+    auto start = chrono::steady_clock::now();
+    action();
+    auto stop = chrono::steady_clock::now();
+    cout.rdbuf(original);
+    output = captured.str();
+    return chrono::duration<double, milli>(stop - start).count();
+}
+
+double measure_to(int fd, const function<void()> &action)
+{
+    /*
+     * Function: measure_to
+     * Parameters: int fd, const function<void()>& action
+     * Purpose: Runs the action with the standard output redirected to
+     * the file descriptor and returns the elapsed time in milliseconds,
+     * including the final flush.
+     */
+    cout.flush();
+    int original = dup(STDOUT_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    auto start = chrono::steady_clock::now();
+    action();
+    cout.flush();
+    auto stop = chrono::steady_clock::now();
+    dup2(original, STDOUT_FILENO);
+    close(original);
+    return chrono::duration<double, milli>(stop - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    vector<Holding> holdings;
+    if (argc > 1 && string(argv[1]) == "--input")
+    {
+        ifstream input_file(argc > 2 ? argv[2] : "");
+        if (!input_file.is_open())
+        {
+            cout << "Error: input file cannot be opened" << endl;
+            return EXIT_FAILURE;
+        }
+        if (!read_holdings(input_file, holdings))
+        {
+            return EXIT_FAILURE;
+        }
+        cout << "input: " << argv[2] << ", rows: " << holdings.size() << endl;
+    }
+    else
+    {
+        size_t rows = argc > 1 ? stoul(argv[1]) : 200000;
+        size_t library_count = argc > 2 ? stoul(argv[2]) : 20;
+        size_t author_count = argc > 3 ? stoul(argv[3]) : 5000;
+
+        holdings = generate_holdings(rows, library_count, author_count);
+        cout << "rows: " << rows << ", libraries: " << library_count
+             << ", authors: " << author_count << endl;
+    }
+
+    legacy::Libraries libraries;
+    Catalog catalog;
+    string unused;
+    double legacy_build = measure([&]()
+    {
+        for (const Holding &holding : holdings)
+        {
+            libraries[holding.library][holding.author].push_back(
+                {holding.author, holding.title, holding.reservations});
+        }
+    }, unused);
+    double flat_build = measure([&]()
+    {
+        catalog = Catalog(holdings);
+    }, unused);
+
+    // Query arguments shared by both layouts
+    vector<string> library_names;
+    for (const auto &library : libraries)
+    {
+        library_names.push_back(library.first);
+    }
+    vector<pair<string, string>> book_queries;
+    for (size_t i = 0; i < holdings.size() && book_queries.size() < 2000; i += 97)
+    {
+        book_queries.emplace_back(holdings[i].library, holdings[i].author);
+    }
+    vector<pair<string, string>> reservable_queries;
+    for (size_t i = 0; i < holdings.size() && reservable_queries.size() < 2000; i += 89)
+    {
+        reservable_queries.emplace_back(holdings[i].author, holdings[i].title);
+    }
+
+    int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (null_fd < 0)
+    {
+        cout << "Error: /dev/null cannot be opened" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // Both layouts write into an in-memory output buffer. The map
+    // layout also runs with the original cout output and with an output
+    // buffer on the standard output, which measure_to redirects.
+    Output legacy_out;
+    Output flat_out;
+    struct Command
+    {
+        string name;
+        function<void()> stream_action;
+        function<void()> fd_action;
+        function<void()> legacy_action;
+        function<void()> flat_action;
+    };
+    auto command = [&legacy_out](const string &name, auto legacy_action, function<void()> flat_action)
+    {
+        return Command{name, [legacy_action]() { legacy_action(cout); },
+                       [legacy_action]()
+                       {
+                           Output out(STDOUT_FILENO);
+                           legacy_action(out);
+                           out.flush();
+                       },
+                       [legacy_action, &legacy_out]() { legacy_action(legacy_out); }, flat_action};
+    };
+    vector<Command> commands = {
+        command("libraries",
+                [&](auto &out) { legacy::print_libraries(libraries, out); },
+                [&]() { print_libraries(catalog, flat_out); }),
+        command("material",
+                [&](auto &out) { for (const auto &name : library_names) legacy::print_material(name, libraries, out); },
+                [&]() { for (const auto &name : library_names) print_material(name, catalog, flat_out); }),
+        command("books",
+                [&](auto &out) { for (const auto &query : book_queries) legacy::print_books(query.first, query.second, libraries, out); },
+                [&]() { for (const auto &query : book_queries) print_books(query.first, query.second, catalog, flat_out); }),
+        command("reservable",
+                [&](auto &out) { for (const auto &query : reservable_queries) legacy::print_reservable(query.first, query.second, libraries, out); },
+                [&]() { for (const auto &query : reservable_queries) print_reservable(query.first, query.second, catalog, flat_out); }),
+        command("loanable",
+                [&](auto &out) { legacy::print_loanable(libraries, out); },
+                [&]() { print_loanable(catalog, flat_out); }),
+    };
+
+    bool all_equal = true;
+    cout << fixed << setprecision(2);
+    cout << left << setw(12) << "command" << right << setw(12) << "cout (ms)"
+         << setw(12) << "fd (ms)" << setw(12) << "map (ms)" << setw(12) << "flat (ms)"
+         << setw(10) << "output" << setw(10) << "layout" << endl;
+    cout << left << setw(12) << "build" << right << setw(12) << "-" << setw(12) << "-"
+         << setw(12) << legacy_build << setw(12) << flat_build
+         << setw(10) << "-" << setw(10) << legacy_build / flat_build << endl;
+    for (const Command &command : commands)
+    {
+        // The captured run only provides the output to compare
+        string stream_output;
+        measure(command.stream_action, stream_output);
+        double stream_time = measure_to(null_fd, command.stream_action);
+        double fd_time = measure_to(null_fd, command.fd_action);
+        legacy_out.clear();
+        double legacy_time = measure(command.legacy_action, unused);
+        flat_out.clear();
+        double flat_time = measure(command.flat_action, unused);
+        cout << left << setw(12) << command.name << right << setw(12) << stream_time
+             << setw(12) << fd_time << setw(12) << legacy_time << setw(12) << flat_time
+             << setw(10) << stream_time / fd_time << setw(10) << legacy_time / flat_time;
+        if (stream_output != legacy_out.str() || legacy_out.str() != flat_out.str())
+        {
+            cout << "   OUTPUT DIFFERS";
+            all_equal = false;
+        }
+        cout << endl;
+    }
+
+    close(null_fd);
+    return all_equal ? EXIT_SUCCESS : EXIT_FAILURE;
+}
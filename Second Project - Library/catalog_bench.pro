@@ -0,0 +1,21 @@
+TEMPLATE = app
+CONFIG += console c++17 thread
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+        catalog.cpp \
+        catalog_bench.cpp \
+        commands.cpp \
+        output.cpp \
+        reservation_log.cpp \
+        search_index.cpp \
+        synthetic.cpp
+
+HEADERS += \
+    catalog.hh \
+    commands.hh \
+    output.hh \
+    reservation_log.hh \
+    search_index.hh \
+    synthetic.hh
@@ -0,0 +1,576 @@
+/* Library Management System
+ * Implementation of the user commands on top of the flat catalog.
+ * */
+
+#include "commands.hh"
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+void print_libraries(const Catalog &catalog, Output &out)
+{
+    /*
+     * Function: print_libraries
+     * Parameters: const Catalog& catalog, Output& out
+     * Purpose: Prints the names of all libraries in the given catalog.
+     */
+    for (uint32_t library = 0; library < catalog.library_count(); library++)
+    {
+        out << catalog.library_name(library) << '\n';
+    }
+}
+
+void print_material(const string &library_name, const Catalog &catalog, Output &out)
+{
+    /*
+     * Function: print_material
+     * Parameters: const string& library_name, const Catalog& catalog,
+     * Output& out
+     * Purpose: Prints all books of given library and an error
+     * message if library is unknown.
+     */
+    uint32_t library = catalog.find_library(library_name);
+
+    if (library != Catalog::npos)
+    {
+        for (uint32_t author = catalog.authors_begin(library);
+             author < catalog.authors_end(library); author++)
+        {
+            string_view author_name = catalog.string_at(catalog.author_id(author));
+            for (uint32_t book = catalog.books_begin(author); book < catalog.books_end(author); book++)
+            {
+                out << author_name << ": " << catalog.string_at(catalog.title_id(book)) << '\n';
+            }
+        }
+    }
+    else
+    {
+        out << "Error: unknown library" << '\n';
+    }
+}
+
+void print_books(const string &library_name, const string &author, const Catalog &catalog,
+                 Output &out)
+{
+    /*
+     * Function: print_books
+     * Parameters: const string& library_name, const string& author,
+     * const Catalog& catalog, Output& out
+     * Purpose: Prints all books by given author in given library.
+     * Also prints reservation status and title for book.
+     */
+
+    uint32_t library = catalog.find_library(library_name);
+
+    if (library != Catalog::npos)
+    {
+        uint32_t author_entry = catalog.find_author(library, catalog.find_string(author));
+        if (author_entry != Catalog::npos)
+        {
+            for (uint32_t book = catalog.books_begin(author_entry);
+                 book < catalog.books_end(author_entry); book++)
+            {
+                out << catalog.string_at(catalog.title_id(book)) << " --- ";
+                if (catalog.reservations(book) == 0)
+                {
+                    out << "on the shelf" << '\n';
+                }
+                else
+                {
+                    out << catalog.reservations(book) << " reservations" << '\n';
+                }
+            }
+        }
+        else
+        {
+            out << "Error: unknown author" << '\n';
+        }
+    }
+    else
+    {
+        out << "Error: unknown library" << '\n';
+    }
+}
+
+void print_reservable(const string &author, const string &title, const Catalog &catalog,
+                      Output &out)
+{
+    /*
+     * Function: print_reservable
+     * Parameters: const string& author, const string& title,
+     * const Catalog& catalog, Output& out
+     * Purpose: Prints libraries for a given book/author
+     * if reservable and let's the user know if
+     * a book is not found from any library.
+     */
+
+    int min_reservations = numeric_limits<int>::max();
+    // Initialize the minimum reservations to the maximum possible value
+    vector<uint32_t> libraries;
+    // Store the libraries with the minimum reservations
+    bool book_found = false;
+    // Flag to indicate if the book is found in any library
+
+    // Strings that are not interned cannot match any book
+    uint32_t author_id = catalog.find_string(author);
+    uint32_t title_id = catalog.find_string(title);
+
+    // Iterate through each library
+    for (uint32_t library = 0; title_id != Catalog::npos && library < catalog.library_count(); library++)
+    {
+        uint32_t author_entry = catalog.find_author(library, author_id);
+        if (author_entry != Catalog::npos)
+        {
+            // Check if the author is found in the library
+            // Iterate through each book by the author
+            for (uint32_t book = catalog.books_begin(author_entry);
+                 book < catalog.books_end(author_entry); book++)
+            {
+                if (catalog.title_id(book) == title_id)
+                { // Check if the book title matches
+                    book_found = true;
+                    int reservations = catalog.reservations(book);
+                    // Update the minimum reservations and
+                    // the corresponding libraries
+                    if (reservations < min_reservations && reservations != 100)
+                    {
+                        min_reservations = reservations;
+                        libraries.clear();
+                        libraries.push_back(library);
+                    }
+                    else if (reservations == min_reservations)
+                    {
+                        libraries.push_back(library);
+                    }
+                }
+            }
+        }
+    }
+
+    // Print the appropriate message based on the search result
+    if (!book_found)
+    {
+        out << "Book is not a library book" << '\n';
+    }
+    else if (min_reservations == 100)
+    {
+        out << "Book is not reservable from any library" << '\n';
+    }
+    else if (min_reservations == numeric_limits<int>::max())
+    {
+        out << "Book is not reservable from any library" << '\n';
+    }
+    else if (min_reservations == 0)
+    {
+        out << "on the shelf" << '\n';
+        for (uint32_t library : libraries)
+        {
+            out << "--- " << catalog.library_name(library) << '\n';
+        }
+    }
+    else
+    {
+        out << min_reservations << " reservations" << '\n';
+        for (uint32_t library : libraries)
+        {
+            out << "--- " << catalog.library_name(library) << '\n';
+        }
+    }
+}
+
+void print_loanable(const Catalog &catalog, Output &out)
+{
+    /*
+     * Function: print_loanable
+     * Parameters: const Catalog& catalog, Output& out
+     * Purpose: Prints a list of all loanable books.
+     */
+
+    // String ids sort like the strings, so sorting the id pairs gives
+    // the author and title order without comparing any text.
+    vector<pair<uint32_t, uint32_t>> loanable_books;
+
+    for (uint32_t author = 0; author < catalog.author_count(); author++)
+    {
+        for (uint32_t book = catalog.books_begin(author); book < catalog.books_end(author); book++)
+        {
+            if (catalog.reservations(book) == 0)
+            {
+                loanable_books.emplace_back(catalog.author_id(author), catalog.title_id(book));
+            }
+        }
+    }
+    sort(loanable_books.begin(), loanable_books.end());
+    loanable_books.erase(unique(loanable_books.begin(), loanable_books.end()), loanable_books.end());
+
+    for (const auto &book : loanable_books)
+    {
+        out << catalog.string_at(book.first) << ": " << catalog.string_at(book.second) << '\n';
+    }
+}
+
+void print_summary(const string &library_name, const Catalog &catalog, Output &out)
+{
+    /*
+     * Function: print_summary
+     * Parameters: const string& library_name, const Catalog& catalog,
+     * Output& out
+     * Purpose: Prints all books of a library in an alphabetical order
+     * of author and title. Authors are already sorted and the title
+     * order is precomputed, so nothing is sorted here.
+     */
+    uint32_t library = catalog.find_library(library_name);
+
+    if (library != Catalog::npos)
+    {
+        for (uint32_t author = catalog.authors_begin(library);
+             author < catalog.authors_end(library); author++)
+        {
+            string_view author_name = catalog.string_at(catalog.author_id(author));
+            for (uint32_t position = catalog.books_begin(author);
+                 position < catalog.books_end(author); position++)
+            {
+                uint32_t book = catalog.book_by_title(position);
+                out << author_name << ": " << catalog.string_at(catalog.title_id(book)) << '\n';
+            }
+        }
+    }
+    else
+    {
+        out << "Error: unknown library" << '\n';
+    }
+}
+
+void print_author_info(const string &library_name, const string &author,
+                       const Catalog &catalog, Output &out)
+{
+    /*
+     * Function: print_author_info
+     * Parameters: const string& library_name, const string& author,
+     * const Catalog& catalog, Output& out
+     * Purpose: This function displays the book title and status of
+     * reservation for the books of an author in a library. The books
+     * come straight from the author's bucket of that library.
+     */
+    uint32_t library = catalog.find_library(library_name);
+    if (library == Catalog::npos)
+    {
+        out << "Error: unknown library" << '\n';
+        return;
+    }
+    uint32_t author_entry = catalog.find_author(library, catalog.find_string(author));
+    if (author_entry == Catalog::npos)
+    {
+        out << "Error: unknown author" << '\n';
+        return;
+    }
+
+    for (uint32_t position = catalog.books_begin(author_entry);
+         position < catalog.books_end(author_entry); position++)
+    {
+        uint32_t book = catalog.book_by_title(position);
+        out << catalog.string_at(catalog.title_id(book)) << " --- ";
+        if (catalog.reservations(book) == 0)
+        {
+            out << "on the shelf";
+            // Book is available on the shelf
+        }
+        else
+        {
+            out << catalog.reservations(book) << " reservations";
+            // Display the number of reservations
+        }
+        out << '\n';
+    }
+}
+
+void print_search(const string &text, bool fuzzy, const SearchIndex &index,
+                  const Catalog &catalog, Output &out)
+{
+    /*
+     * Function: print_search
+     * Parameters: const string& text, bool fuzzy, const SearchIndex& index,
+     * const Catalog& catalog, Output& out
+     * Purpose: Prints the books whose author or title starts with or
+     * resembles the given text, best match first.
+     */
+    const size_t result_limit = 20;
+    vector<Work> works = fuzzy ? index.fuzzy(text, result_limit) : index.prefix(text, result_limit);
+
+    if (works.empty())
+    {
+        out << "No matching books" << '\n';
+    }
+    for (const Work &work : works)
+    {
+        out << catalog.string_at(work.first) << ": " << catalog.string_at(work.second) << '\n';
+    }
+}
+
+void change_reservation(const string &library_name, const string &author, const string &title,
+                        int delta, Catalog &catalog, ReservationLog &log, Output &out)
+{
+    /*
+     * Function: change_reservation
+     * Parameters: const string& library_name, const string& author,
+     * const string& title, int delta, Catalog& catalog,
+     * ReservationLog& log, Output& out
+     * Purpose: Adds or removes a reservation of a book in a library,
+     * records the change in the log and prints the new status.
+     */
+    uint32_t library = catalog.find_library(library_name);
+    if (library == Catalog::npos)
+    {
+        out << "Error: unknown library" << '\n';
+        return;
+    }
+    uint32_t author_entry = catalog.find_author(library, catalog.find_string(author));
+    if (author_entry == Catalog::npos)
+    {
+        out << "Error: unknown author" << '\n';
+        return;
+    }
+    uint32_t title_id = catalog.find_string(title);
+    bool title_found = false;
+    for (uint32_t book = catalog.books_begin(author_entry);
+         title_id != Catalog::npos && book < catalog.books_end(author_entry); book++)
+    {
+        title_found = title_found || catalog.title_id(book) == title_id;
+    }
+    if (!title_found)
+    {
+        out << "Book is not a library book" << '\n';
+        return;
+    }
+    if (!log.writable())
+    {
+        out << "Error: reservation log cannot be written" << '\n';
+        return;
+    }
+
+    uint32_t book = catalog.change_reservations(author_entry, title_id, delta);
+    if (book == Catalog::npos)
+    {
+        if (delta > 0)
+        {
+            out << "Book is not reservable from this library" << '\n';
+        }
+        else
+        {
+            out << "Book has no reservations" << '\n';
+        }
+        return;
+    }
+    if (!log.append(library, author_entry, book, delta))
+    {
+        // Undo the change so memory never gets ahead of the log
+        catalog.add_reservations(book, -delta);
+        out << "Error: reservation log cannot be written" << '\n';
+        return;
+    }
+
+    int reservations = catalog.reservations(book);
+    out << title << " --- ";
+    if (reservations == 0)
+    {
+        out << "on the shelf" << '\n';
+    }
+    else
+    {
+        out << reservations << " reservations" << '\n';
+    }
+}
+
+void read_title(istream &cmd_stream, string &title)
+{
+    /*
+     * Function: read_title
+     * Parameters: istream& cmd_stream, string& title
+     * Purpose: Reads the rest of a command line as a title. The title
+     * may be enclosed in double quotes.
+     */
+
+    // Check if the title has double quotes around it
+    if (cmd_stream.peek() == ' ')
+    {
+        cmd_stream.ignore(1, ' ');
+    }
+
+    if (cmd_stream.peek() == '\"')
+    {
+        // Extract the title parameter enclosed in double quotes
+        getline(cmd_stream.ignore(), title, '\"');
+    }
+    else
+    {
+        getline(cmd_stream, title);
+    }
+}
+
+void read_author(istream &cmd_stream, string &author)
+{
+    /*
+     * Function: read_author
+     * Parameters: istream& cmd_stream, string& author
+     * Purpose: Reads one author from a command line. An author of
+     * several words is enclosed in double quotes, like a title.
+     */
+    cmd_stream >> ws;
+    if (cmd_stream.peek() == '\"')
+    {
+        getline(cmd_stream.ignore(), author, '\"');
+    }
+    else
+    {
+        cmd_stream >> author;
+    }
+}
+
+bool execute_command(const string &command, Catalog &catalog, ReservationLog &log,
+                     const SearchIndex &index, Output &out)
+{
+    /*
+     * Function: execute_command
+     * Parameters: const string& command, Catalog& catalog,
+     * ReservationLog& log, const SearchIndex& index, Output& out
+     * Purpose: Parses one command line and writes its result to the
+     * given output buffer. Returns false if the command ends the session.
+     */
+    stringstream cmd_stream(command);
+    string cmd;
+    cmd_stream >> cmd;
+
+    // Check the user command and perform the corresponding action
+    if (cmd == "quit" || cmd == "exit")
+    {
+        return false;
+    }
+    else if (cmd == "libraries")
+    {
+        // Print the list of libraries
+        print_libraries(catalog, out);
+    }
+    else if (cmd == "material")
+    {
+        string library_name;
+        if (cmd_stream >> library_name)
+        {
+            // Print the list of materials in a specific library
+            print_material(library_name, catalog, out);
+        }
+        else
+        {
+            out << "Error: wrong number of parameters" << '\n';
+        }
+    }
+    else if (cmd == "books")
+    {
+        string library_name, author;
+        if (cmd_stream >> library_name >> ws)
+        {
+            // Extract the author parameter (with possible spaces)
+            getline(cmd_stream, author);
+            if (!author.empty())
+            {
+                // Print the list of books by a specific author in a specific library
+                print_books(library_name, author, catalog, out);
+            }
+            else
+            {
+                out << "Error: wrong number of parameters" << '\n';
+            }
+        }
+        else
+        {
+            out << "Error: wrong number of parameters" << '\n';
+        }
+    }
+    else if (cmd == "reservable")
+    {
+        string author, title;
+        cmd_stream >> author;
+        read_title(cmd_stream, title);
+
+        // Check if author and title are not empty, then call the function
+        if (!author.empty() && !title.empty())
+        {
+            // Print the availability of a specific book for reservation
+            print_reservable(author, title, catalog, out);
+        }
+        else
+        {
+            out << "Error: wrong number of parameters" << '\n';
+        }
+    }
+    else if (cmd == "loanable")
+    {
+        // Print the list of books available for loan
+        print_loanable(catalog, out);
+    }
+    else if (cmd == "summary")
+    {
+        string library_name;
+        if (cmd_stream >> library_name)
+        {
+            // Print the books of a library by author and title
+            print_summary(library_name, catalog, out);
+        }
+        else
+        {
+            out << "Error: wrong number of parameters" << '\n';
+        }
+    }
+    else if (cmd == "author")
+    {
+        string library_name, author;
+        if (cmd_stream >> library_name >> ws && getline(cmd_stream, author) && !author.empty())
+        {
+            // Print the books of an author in a library by title
+            print_author_info(library_name, author, catalog, out);
+        }
+        else
+        {
+            out << "Error: wrong number of parameters" << '\n';
+        }
+    }
+    else if (cmd == "search" || cmd == "prefix")
+    {
+        string text;
+        if (getline(cmd_stream >> ws, text) && !text.empty())
+        {
+            // Print the books matching a mistyped or partial author or title
+            print_search(text, cmd == "search", index, catalog, out);
+        }
+        else
+        {
+            out << "Error: wrong number of parameters" << '\n';
+        }
+    }
+    else if (cmd == "reserve" || cmd == "return")
+    {
+        string library_name, author, title;
+        cmd_stream >> library_name;
+        read_author(cmd_stream, author);
+        read_title(cmd_stream, title);
+
+        if (!library_name.empty() && !author.empty() && !title.empty())
+        {
+            // Reserving adds one reservation, returning removes one
+            change_reservation(library_name, author, title, cmd == "reserve" ? 1 : -1,
+                               catalog, log, out);
+        }
+        else
+        {
+            out << "Error: wrong number of parameters" << '\n';
+        }
+    }
+    else
+    {
+        out << "Error: unknown command" << '\n';
+    }
+    return true;
+}
@@ -0,0 +1,59 @@
+/* Library Management System
+ * The purpose of this header file is to declare the functions
+ * that print the results of the user commands. Every function
+ * writes to the given output buffer, so the same commands serve the
+ * interactive prompt, scripts and the socket server.
+ * */
+
+#ifndef COMMANDS_HH
+#define COMMANDS_HH
+
+#include "catalog.hh"
+#include "output.hh"
+#include "reservation_log.hh"
+#include "search_index.hh"
+#include <string>
+
+// Declare a function for printing the names of all libraries.
+void print_libraries(const Catalog &catalog, Output &out);
+
+// Declare a function for printing all books of a library.
+void print_material(const std::string &library_name, const Catalog &catalog,
+                    Output &out);
+
+// Declare a function for printing the books of an author in a library.
+void print_books(const std::string &library_name, const std::string &author,
+                 const Catalog &catalog, Output &out);
+
+// Declare a function for printing the libraries a book is best reserved from.
+void print_reservable(const std::string &author, const std::string &title,
+                      const Catalog &catalog, Output &out);
+
+// Declare a function for printing all loanable books.
+void print_loanable(const Catalog &catalog, Output &out);
+
+// Declare a function for printing all books of a library by author and title.
+void print_summary(const std::string &library_name, const Catalog &catalog,
+                   Output &out);
+
+// Declare a function for printing the books of an author in a library by title.
+void print_author_info(const std::string &library_name, const std::string &author,
+                       const Catalog &catalog, Output &out);
+
+// Declare a function for printing the books matching a text. Fuzzy search
+// tolerates typos, otherwise the author or title must start with the text.
+void print_search(const std::string &text, bool fuzzy, const SearchIndex &index,
+                  const Catalog &catalog, Output &out);
+
+// Declare a function for reserving (delta 1) or returning (delta -1) a
+// book in a library. The change is written to the log.
+void change_reservation(const std::string &library_name, const std::string &author,
+                        const std::string &title, int delta, Catalog &catalog,
+                        ReservationLog &log, Output &out);
+
+// Declare a function for running one command line. Returns false if
+// the command ends the session.
+bool execute_command(const std::string &command, Catalog &catalog, ReservationLog &log,
+                     const SearchIndex &index, Output &out);
+
+#endif // COMMANDS_HH
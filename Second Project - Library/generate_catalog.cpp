@@ -0,0 +1,49 @@
+/* Library Management System
+ * Writes a synthetic library input file for testing and benchmarking.
+ *
+ * Usage: generate_catalog [options] [output file]
+ * Without an output file the lines are written to the standard output.
+ * */
+
+#include "synthetic.hh"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    GeneratorOptions options;
+    string output_file;
+    for (int i = 1; i < argc; i++)
+    {
+        string option = argv[i];
+        if (option.compare(0, 2, "--") != 0 && output_file.empty())
+        {
+            output_file = option;
+        }
+        else if (i + 1 >= argc || !set_generator_option(option, argv[++i], options))
+        {
+            cout << "Usage: " << argv[0] << " [options] [output file]" << endl
+                 << generator_usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (output_file.empty())
+    {
+        generate_catalog(options, cout);
+        return EXIT_SUCCESS;
+    }
+
+    ofstream file(output_file, ios::binary);
+    if (!file.is_open())
+    {
+        cout << "Error: output file cannot be opened" << endl;
+        return EXIT_FAILURE;
+    }
+    generate_catalog(options, file);
+    return file ? EXIT_SUCCESS : EXIT_FAILURE;
+}
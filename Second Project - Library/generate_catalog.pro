@@ -0,0 +1,11 @@
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+        generate_catalog.cpp \
+        synthetic.cpp
+
+HEADERS += \
+    synthetic.hh
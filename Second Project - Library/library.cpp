@@ -18,487 +18,198 @@
  *
  */
 
+#include "catalog.hh"
+#include "commands.hh"
+#include "output.hh"
+#include "reservation_log.hh"
+#include "search_index.hh"
+#include "server.hh"
+#include <chrono>
+#include <iomanip>
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include <algorithm>
-#include <iterator>
-#include <map>
-#include <set>
-#include <limits>
+#include <thread>
+#include <unistd.h>
 
 using namespace std;
 
-struct Book
-{
-    string author;
-    string title;
-    int reservations = 0;
-};
-
-void print_libraries(const map<string, map<string, vector<Book>>> &libraries)
+int run_script(const string &script_file, Catalog &catalog, ReservationLog &log,
+               const SearchIndex &index)
 {
     /*
-     * Function: print_libraries
-     * Parameters: const map<string, map<string, vector<Book>>>& libraries
-     * Purpose: Prints the names of all libraries in the given data structure.
+     * Function: run_script
+     * Parameters: const string& script_file, Catalog& catalog,
+     * ReservationLog& log, const SearchIndex& index
+     * Purpose: Runs every command of a file without prompts. Results go
+     * to the standard output and the time each command took, output
+     * included, goes to the standard error.
      */
-    for (const auto &library : libraries)
+    ifstream script(script_file);
+    if (!script.is_open())
     {
-        cout << library.first << endl;
-    }
-}
-
-void print_material(const string &library_name, const map<string,
-                                                          map<string, vector<Book>>> &libraries)
-{
-    /*
-     * Function: print_material
-     * Parameters: const string& library_name, const map<string,
-     * map<string, vector<Book>>>& libraries
-     * Purpose: Prints all books of given library and an error
-     * message if library is unknown.
-     */
-    auto library_iter = libraries.find(library_name);
-
-    if (library_iter != libraries.end())
-    {
-        for (const auto &author : library_iter->second)
-        {
-            for (const auto &book : author.second)
-            {
-                cout << author.first << ": " << book.title << endl;
-            }
-        }
-    }
-    else
-    {
-        cout << "Error: unknown library" << endl;
+        cout << "Error: script file cannot be opened" << endl;
+        return EXIT_FAILURE;
     }
-}
-
-void print_books(const string &library_name, const string &author, const map<string, map<string, vector<Book>>> &libraries)
-{
-    /*
-     * Function: print_books
-     * Parameters: const string& library_name, const string& author,
-     * const map<string, map<string, vector<Book>>>& libraries
-     * Purpose: Prints all books by given author in given library.
-     * Also prints reservation status and title for book.
-     */
 
-    auto library_iter = libraries.find(library_name);
-
-    if (library_iter != libraries.end())
+    Output out(STDOUT_FILENO);
+    double total_ms = 0;
+    string command;
+    cerr << fixed << setprecision(3);
+    while (getline(script, command))
     {
-        auto author_iter = library_iter->second.find(author);
-        if (author_iter != library_iter->second.end())
+        if (command.empty())
         {
-            for (const auto &book : author_iter->second)
-            {
-                cout << book.title << " --- ";
-                if (book.reservations == 0)
-                {
-                    cout << "on the shelf" << endl;
-                }
-                else
-                {
-                    cout << book.reservations << " reservations" << endl;
-                }
-            }
+            continue;
         }
-        else
+        auto start = chrono::steady_clock::now();
+        bool go_on = execute_command(command, catalog, log, index, out);
+        out.flush();
+        double elapsed_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        total_ms += elapsed_ms;
+        cerr << elapsed_ms << " ms  " << command << '\n';
+        if (!go_on)
         {
-            cout << "Error: unknown author" << endl;
+            break;
         }
     }
-    else
-    {
-        cout << "Error: unknown library" << endl;
-    }
+    cerr << total_ms << " ms  total" << endl;
+    return EXIT_SUCCESS;
 }
 
-void print_reservable(const string &author, const string &title,
-                      const map<string, map<string, vector<Book>>> &libraries)
+int main(int argc, char *argv[])
 {
     /*
-     * Function: print_reservable
-     * Parameters: const string& author, const string& title,
-     * const map<string, map<string, vector<Book>>>& libraries
-     * Purpose: Prints libraries for a given book/author
-     * if reservable and let's the user know if
-     * a book is not found from any library.
+     * Function: main
+     * Purpose: Stores data from a CSV input file and defines a command interface.
+     *          Supports commands that allow the user to interact with the data,
+     *          such as checking the availability of books in different libraries.
+     *          With --snapshot <file> the parsed catalog is kept in a snapshot
+     *          file and later runs map it instead of parsing the CSV again.
+     *          With --serve <socket> the commands are answered on a Unix domain
+     *          socket instead of the prompt, using --workers threads.
+     *          Reservation changes are kept in a log next to the input file,
+     *          or in the file given with --log. --input names the input file
+     *          instead of asking for it and --script runs the commands of a
+     *          file instead of the prompt, timing each of them.
      */
 
-    int min_reservations = numeric_limits<int>::max();
-    // Initialize the minimum reservations to the maximum possible value
-    vector<string> library_names;
-    // Store the names of libraries with the minimum reservations
-    bool book_found = false;
-    // Flag to indicate if the book is found in any library
-
-    // Iterate through each library
-    for (const auto &library : libraries)
+    string snapshot_file;
+    string socket_path;
+    string log_file;
+    string input_file;
+    string script_file;
+    unsigned worker_count = thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++)
     {
-        auto author_iter = library.second.find(author);
-        if (author_iter != library.second.end())
+        string option = argv[i];
+        if (i + 1 < argc && option == "--snapshot")
         {
-            // Check if the author is found in the library
-            // Iterate through each book by the author
-            for (const auto &book : author_iter->second)
-            {
-                if (book.title == title)
-                { // Check if the book title matches
-                    book_found = true;
-                    // Update the minimum reservations and
-                    // the corresponding library names
-                    if (book.reservations < min_reservations &&
-                        book.reservations != 100)
-                    {
-                        min_reservations = book.reservations;
-                        library_names.clear();
-                        library_names.push_back(library.first);
-                    }
-                    else if (book.reservations == min_reservations)
-                    {
-                        library_names.push_back(library.first);
-                    }
-                }
-            }
+            snapshot_file = argv[++i];
         }
-    }
-
-    // Print the appropriate message based on the search result
-    if (!book_found)
-    {
-        cout << "Book is not a library book" << endl;
-    }
-    else if (min_reservations == 100)
-    {
-        cout << "Book is not reservable from any library" << endl;
-    }
-    else if (min_reservations == numeric_limits<int>::max())
-    {
-        cout << "Book is not reservable from any library" << endl;
-    }
-    else if (min_reservations == 0)
-    {
-        cout << "on the shelf" << endl;
-        for (const auto &library_name : library_names)
+        else if (i + 1 < argc && option == "--serve")
         {
-            cout << "--- " << library_name << endl;
+            socket_path = argv[++i];
         }
-    }
-    else
-    {
-        cout << min_reservations << " reservations" << endl;
-        for (const auto &library_name : library_names)
+        else if (i + 1 < argc && option == "--input")
         {
-            cout << "--- " << library_name << endl;
+            input_file = argv[++i];
         }
-    }
-}
-
-void print_loanable(const map<string, map<string, vector<Book>>> &libraries)
-{
-    /*
-     * Function: print_loanable
-     * Parameters: const map<string, map<string, vector<Book>>>& libraries
-     * Purpose: Prints a list of all loanable books.
-     */
-    map<string, std::set<string>> loanable_books;
-
-    for (const auto &library : libraries)
-    {
-        for (const auto &author : library.second)
+        else if (i + 1 < argc && option == "--script")
         {
-            for (const auto &book : author.second)
-            {
-                if (book.reservations == 0)
-                {
-                    loanable_books[author.first].insert(book.title);
-                }
-            }
+            script_file = argv[++i];
         }
-    }
-
-    for (const auto &author : loanable_books)
-    {
-        for (const auto &title : author.second)
+        else if (i + 1 < argc && option == "--log")
         {
-            cout << author.first << ": " << title << endl;
+            log_file = argv[++i];
         }
-    }
-}
-
-bool book_compare(const Book &a, const Book &b)
-{
-    /*
-     * Function: book_compare
-     * Parameters: const Book& a, const Book& b
-     * Purpose: Compares 2 book objects
-     * Usage: This function is typically used
-     * as a comparator in sorting algorithms.
-     * This function was partly inspired by https://www.geeksforgeeks.org/
-     */
-    if (a.author == b.author)
-    {
-        return a.title < b.title;
-    }
-    return a.author < b.author;
-}
-
-void summary(const string &library, const unordered_map<string,
-                                                        unordered_map<string, Book>> &libraries)
-{
-    /*
-     * Function: summary
-     * Parameters: const string& library, const unordered_map<string,
-     * unordered_map<string, Book>>& libraries
-     * Purpose: Prints a summary of available books in an alphabetical order.
-     */
-    auto lib_iter = libraries.find(library);
-    if (lib_iter != libraries.end())
-    {
-        vector<Book> books;
-        for (const auto &book_entry : lib_iter->second)
+        else if (i + 1 < argc && option == "--workers")
         {
-            books.push_back(book_entry.second);
+            worker_count = static_cast<unsigned>(stoul(argv[++i]));
         }
-        sort(books.begin(), books.end(), book_compare);
-        for (const Book &book : books)
+        else
         {
-            cout << book.author << ": " << book.title << endl;
+            cout << "Usage: " << argv[0]
+                 << " [--input <file>] [--snapshot <file>] [--log <file>]"
+                 << " [--script <file> | --serve <socket> [--workers <count>]]" << endl;
+            return EXIT_FAILURE;
         }
     }
-    else
-    {
-        cout << "Error: unknown library" << endl;
-    }
-}
 
-void author_info(const string &library, const string &author,
-                 const unordered_map<string, unordered_map<string, Book>> &libraries)
-{
-    /*
-     * Function: author_info
-     * Parameters: const string& library, const string& author,
-     * const unordered_map<string, unordered_map<string, Book>>& libraries
-     * Purpose: This function displays the book title and status of reservation.
-     * Also an error message is implemented.
-     */
-
-    auto lib_iter = libraries.find(library);
-    if (lib_iter != libraries.end())
-    {
-        // Check if the library exists
-        bool author_found = false;
-        // Flag to indicate if the author is found in the library
-        for (const auto &book_entry : lib_iter->second)
-        {
-            const Book &book = book_entry.second;
-            if (book.author == author)
-            {
-                // Check if the book author matches
-                author_found = true;
-                cout << book.title << " --- ";
-                if (book.reservations == 0)
-                {
-                    cout << "on the shelf";
-                    // Book is available on the shelf
-                }
-                else
-                {
-                    cout << book.reservations << " reservations";
-                    // Display the number of reservations
-                }
-                cout << endl;
-            }
-        }
-        if (!author_found)
-        {
-            cout << "Error: unknown author" << endl;
-            // The author is not found in the library
-        }
-    }
-    else
+    bool ask_input_file = input_file.empty();
+    if (ask_input_file)
     {
-        cout << "Error: unknown library" << endl;
-        // The library is not found
+        cout << "Input file: ";
+        cin >> input_file;
     }
-}
-
-bool operator==(const Book &a, const Book &b)
-{
-    return a.author == b.author && a.title == b.title;
-}
-
-int main()
-{
-    /*
-     * Function: main
-     * Purpose: Stores data from a CSV input file and defines a command interface.
-     *          Supports commands that allow the user to interact with the data,
-     *          such as checking the availability of books in different libraries.
-     */
-
-    string input_file;
-    cout << "Input file: ";
-    cin >> input_file;
 
     // Open the input file
     ifstream file(input_file);
-    if (!file.is_open())
+    SourceStamp source;
+    if (!file.is_open() || !read_source_stamp(input_file, source))
     {
         cout << "Error: input file cannot be opened" << endl;
         return EXIT_FAILURE;
     }
 
-    // Read data from the input file and store it in the libraries data structure
-    map<string, map<string, vector<Book>>> libraries;
-    string line;
-    while (getline(file, line))
+    // Use the snapshot if it was built from this version of the input file
+    Catalog libraries;
+    if (snapshot_file.empty() || !libraries.open_snapshot(snapshot_file, source))
     {
-        stringstream ss(line);
-        string library, author, title, reservations_str;
-
-        // Read and process input based on the delimiter (; or ,)
-        if (line.find(';') != string::npos)
-        {
-            getline(ss, library, ';');
-            getline(ss, author, ';');
-            getline(ss, title, ';');
-            getline(ss, reservations_str, ';');
-        }
-        else if (line.find(',') != string::npos)
+        // Read data from the input file and store it in the catalog
+        vector<Holding> holdings;
+        if (!read_holdings(file, holdings))
         {
-            getline(ss, library, ',');
-            getline(ss, author, ',');
-            getline(ss, title, ',');
-            getline(ss, reservations_str, ',');
-        }
-        else
-        {
-            cout << "Error: unknown delimiter" << endl;
             return EXIT_FAILURE;
         }
+        libraries = Catalog(holdings);
 
-        // Check for empty fields
-        if (library.empty() || author.empty() || title.empty() || reservations_str.empty())
+        if (!snapshot_file.empty() && !libraries.write_snapshot(snapshot_file, source))
         {
-            cout << "Error: empty field" << endl;
-            return EXIT_FAILURE;
+            cout << "Error: snapshot file cannot be written" << endl;
         }
-
-        // Convert reservations_str to an integer
-        int reservations = (reservations_str == "on-the-shelf") ? 0 : stoi(reservations_str);
-
-        // Create a book object and add it to the libraries data structure
-        Book book = {author, title, reservations};
-        libraries[library][author].push_back(book);
     }
     file.close();
 
-    cin.ignore();
-    // Process commands entered by the user
-    string command;
-    while (true)
+    // Apply the reservation changes made since the input file was
+    // written. The log is only created when a reservation changes.
+    ReservationLog log;
+    if (!log.open(log_file.empty() ? input_file + ".log" : log_file, libraries))
     {
-        cout << "lib> ";
-        getline(cin, command);
+        cerr << "Error: reservation log cannot be read" << endl;
+    }
 
-        stringstream cmd_stream(command);
-        string cmd;
-        cmd_stream >> cmd;
+    // The first prefix or search command builds the search index. A
+    // server builds it up front, so no client waits for it.
+    SearchIndex index(libraries);
 
-        // Check the user command and perform the corresponding action
-        if (cmd == "quit" || cmd == "exit")
-        {
-            break;
-        }
-        else if (cmd == "libraries")
-        {
-            // Print the list of libraries
-            print_libraries(libraries);
-        }
-        else if (cmd == "material")
-        {
-            string library_name;
-            if (cmd_stream >> library_name)
-            {
-                // Print the list of materials in a specific library
-                print_material(library_name, libraries);
-            }
-            else
-            {
-                cout << "Error: wrong number of parameters" << endl;
-            }
-        }
-        else if (cmd == "books")
-        {
-            string library_name, author;
-            if (cmd_stream >> library_name >> ws)
-            {
-                // Extract the author parameter (with possible spaces)
-                getline(cmd_stream, author);
-                if (!author.empty())
-                {
-                    // Print the list of books by a specific author in a specific library
-                    print_books(library_name, author, libraries);
-                }
-                else
-                {
-                    cout << "Error: wrong number of parameters" << endl;
-                }
-            }
-            else
-            {
-                cout << "Error: wrong number of parameters" << endl;
-            }
-        }
-        else if (cmd == "reservable")
-        {
-            string author, title;
-            cmd_stream >> author;
-
-            // Check if the title has double quotes around it
-            if (cmd_stream.peek() == ' ')
-            {
-                cmd_stream.ignore(1, ' ');
-            }
+    if (!socket_path.empty())
+    {
+        index.build_in_background();
+        return run_server(socket_path, libraries, log, index, worker_count);
+    }
 
-            if (cmd_stream.peek() == '\"')
-            {
-                // Extract the title parameter enclosed in double quotes
-                getline(cmd_stream.ignore(), title, '\"');
-            }
-            else
-            {
-                getline(cmd_stream, title);
-            }
+    if (!script_file.empty())
+    {
+        return run_script(script_file, libraries, log, index);
+    }
 
-            // Check if author and title are not empty, then call the function
-            if (!author.empty() && !title.empty())
-            {
-                // Print the availability of a specific book for reservation
-                print_reservable(author, title, libraries);
-            }
-            else
-            {
-                cout << "Error: wrong number of parameters" << endl;
-            }
-        }
-        else if (cmd == "loanable")
-        {
-            // Print the list of books available for loan
-            print_loanable(libraries);
-        }
-        else
+    if (ask_input_file)
+    {
+        cin.ignore();
+    }
+    // Process commands entered by the user. The output of a command is
+    // written at once when it is done, or in large chunks while it runs.
+    Output out(STDOUT_FILENO);
+    string command;
+    while (true)
+    {
+        out << "lib> ";
+        out.flush();
+        if (!getline(cin, command) || !execute_command(command, libraries, log, index, out))
         {
-            cout << "Error: unknown command" << endl;
+            break;
         }
     }
 }
@@ -1,8 +1,41 @@
 TEMPLATE = app
-CONFIG += console c++11
+CONFIG += console c++17 thread
 CONFIG -= app_bundle
 CONFIG -= qt
 
 SOURCES += \
-        main.cpp
+        catalog.cpp \
+        commands.cpp \
+        library.cpp \
+        output.cpp \
+        reservation_log.cpp \
+        search_index.cpp \
+        server.cpp
 
+HEADERS += \
+    catalog.hh \
+    commands.hh \
+    output.hh \
+    reservation_log.hh \
+    search_index.hh \
+    server.hh
+
+# "make check" runs the golden output tests in tests/. The server test
+# needs library_client, built from library_client.pro into the same
+# directory.
+# The server test of make check talks to the program through the client,
+# so the client is built next to the program first
+client.commands = $(QMAKE) -o Makefile.library_client $$shell_quote($$PWD/library_client.pro) \
+    && $(MAKE) -f Makefile.library_client
+check.commands = sh $$shell_quote($$PWD/tests/run_golden.sh) \
+    $$shell_quote($$OUT_PWD/library) $$shell_quote($$OUT_PWD/library_client)
+check.depends = $(TARGET) client
+QMAKE_EXTRA_TARGETS += client check
+
+DISTFILES += \
+    tests/commands.txt \
+    tests/expected_commands.txt \
+    tests/expected_replay.txt \
+    tests/library.csv \
+    tests/replay_commands.txt \
+    tests/run_golden.sh
@@ -0,0 +1,206 @@
+/* Library Management System
+ * Benchmark of the whole program path over synthetic input files of
+ * growing size. For every size an input file is generated, read and
+ * built into the catalog like the program does at startup, and the
+ * material, books, reservable and loanable commands are timed one call
+ * at a time. Every size runs in its own process, so the peak resident
+ * set size reported belongs to that size alone.
+ *
+ * Usage: library_bench [--sizes 1000,10000,...] [--dir <directory>]
+ *                      [generator options]
+ * */
+
+#include "catalog.hh"
+#include "commands.hh"
+#include "output.hh"
+#include "synthetic.hh"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const size_t max_samples = 1000;
+
+    double elapsed_ms(chrono::steady_clock::time_point start)
+    {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    void print_latency(const string &name, const function<void(size_t)> &action,
+                       size_t runs, Output &out)
+    {
+        /*
+         * Function: print_latency
+         * Parameters: const string& name, const function<void(size_t)>& action,
+         * size_t runs, Output& out
+         * Purpose: Calls the action runs times with the run number and
+         * prints the median and 99th percentile of a single call in
+         * microseconds. The output buffer is emptied between the calls.
+         */
+        vector<double> times;
+        times.reserve(runs);
+        for (size_t run = 0; run < runs; run++)
+        {
+            out.clear();
+            auto start = chrono::steady_clock::now();
+            action(run);
+            times.push_back(elapsed_ms(start) * 1000);
+        }
+        sort(times.begin(), times.end());
+        cout << "  " << left << setw(12) << name << right
+             << setw(12) << times[times.size() / 2]
+             << setw(12) << times[min(times.size() - 1, times.size() * 99 / 100)]
+             << setw(8) << runs << endl;
+    }
+
+    int run_size(const GeneratorOptions &options, const string &directory)
+    {
+        /*
+         * Function: run_size
+         * Parameters: const GeneratorOptions& options, const string& directory
+         * Purpose: Generates an input file of options.rows lines, loads it
+         * and times the commands. Removes the file when done.
+         */
+        string file_name = directory + "/library_bench_" + to_string(getpid()) + ".csv";
+        {
+            ofstream file(file_name, ios::binary);
+            if (!file.is_open())
+            {
+                cout << "Error: benchmark file cannot be created" << endl;
+                return EXIT_FAILURE;
+            }
+            generate_catalog(options, file);
+        }
+        SourceStamp stamp;
+        read_source_stamp(file_name, stamp);
+
+        // Load the file the same way the program does without a snapshot
+        auto start = chrono::steady_clock::now();
+        vector<Holding> holdings;
+        {
+            ifstream input_file(file_name);
+            if (!read_holdings(input_file, holdings))
+            {
+                remove(file_name.c_str());
+                return EXIT_FAILURE;
+            }
+        }
+        Catalog catalog(holdings);
+        double load_ms = elapsed_ms(start);
+        remove(file_name.c_str());
+
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+
+        cout << setw(12) << options.rows << setw(12) << load_ms
+             << setw(14) << options.rows / (load_ms / 1000)
+             << setw(10) << stamp.size / (load_ms / 1000) / (1 << 20)
+             << setw(14) << usage.ru_maxrss / 1024.0 << endl;
+
+        // Query arguments are taken from evenly spaced lines of the file
+        vector<Holding> samples;
+        size_t stride = max<size_t>(1, holdings.size() / max_samples);
+        for (size_t i = 0; i < holdings.size() && samples.size() < max_samples; i += stride)
+        {
+            samples.push_back(holdings[i]);
+        }
+        vector<Holding>().swap(holdings);
+        if (samples.empty())
+        {
+            return EXIT_SUCCESS;
+        }
+
+        Output out;
+        print_latency("material", [&](size_t run)
+        {
+            print_material(samples[run].library, catalog, out);
+        }, samples.size(), out);
+        print_latency("books", [&](size_t run)
+        {
+            print_books(samples[run].library, samples[run].author, catalog, out);
+        }, samples.size(), out);
+        print_latency("reservable", [&](size_t run)
+        {
+            print_reservable(samples[run].author, samples[run].title, catalog, out);
+        }, samples.size(), out);
+        print_latency("loanable", [&](size_t)
+        {
+            print_loanable(catalog, out);
+        }, 5, out);
+        return EXIT_SUCCESS;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    GeneratorOptions options;
+    vector<uint64_t> sizes = {1000, 10000, 100000, 1000000};
+    string directory = ".";
+    for (int i = 1; i < argc; i++)
+    {
+        string option = argv[i];
+        if (i + 1 < argc && option == "--sizes")
+        {
+            sizes.clear();
+            stringstream list(argv[++i]);
+            string size;
+            while (getline(list, size, ','))
+            {
+                sizes.push_back(stoull(size));
+            }
+        }
+        else if (i + 1 < argc && option == "--dir")
+        {
+            directory = argv[++i];
+        }
+        else if (i + 1 >= argc || !set_generator_option(option, argv[++i], options))
+        {
+            cout << "Usage: " << argv[0] << " [--sizes <n,n,...>] [--dir <directory>] [options]" << endl
+                 << generator_usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    cout << fixed << setprecision(1);
+    cout << setw(12) << "rows" << setw(12) << "load (ms)" << setw(14) << "rows/s"
+         << setw(10) << "MB/s" << setw(14) << "peak RSS MB" << endl;
+    cout << "  " << left << setw(12) << "command" << right << setw(12) << "p50 (us)"
+         << setw(12) << "p99 (us)" << setw(8) << "calls" << endl;
+
+    int result = EXIT_SUCCESS;
+    for (uint64_t size : sizes)
+    {
+        options.rows = size;
+        cout.flush();
+        pid_t child = fork();
+        if (child == 0)
+        {
+            int child_result = run_size(options, directory);
+            cout.flush();
+            _exit(child_result);
+        }
+
+        int status = 0;
+        if (child < 0 || waitpid(child, &status, 0) < 0 ||
+            !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+        {
+            cout << "Error: benchmark of " << size << " rows failed" << endl;
+            result = EXIT_FAILURE;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,242 @@
+/* Library Management System
+ * Load generator for the library socket server. Every connection runs
+ * in its own thread and sends commands one at a time, waiting for each
+ * answer. Afterwards the latency percentiles and the throughput over
+ * all connections are printed.
+ *
+ * Usage: library_client <socket> [connections] [requests] [command file]
+ *        library_client <socket> --print <command file>
+ * The command file has one command per line; without it every request
+ * is "libraries". With --print the commands are sent once, in order, on
+ * one connection and the answers are printed instead of timed.
+ * */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+int connect_to(const string &socket_path)
+{
+    /*
+     * Function: connect_to
+     * Parameters: const string& socket_path
+     * Purpose: Opens a connection to the server. Returns -1 on failure.
+     */
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+    {
+        return -1;
+    }
+    memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+bool request(int fd, const string &command, string &pending, string *answer = nullptr)
+{
+    /*
+     * Function: request
+     * Parameters: int fd, const string& command, string& pending,
+     * string* answer
+     * Purpose: Sends one command and reads its complete answer, which
+     * is stored in answer if given. Bytes received past the answer are
+     * kept in pending.
+     */
+    string line = command + "\n";
+    size_t sent = 0;
+    while (sent < line.size())
+    {
+        ssize_t count = send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+        if (count <= 0)
+        {
+            return false;
+        }
+        sent += static_cast<size_t>(count);
+    }
+
+    // The answer is its length on one line followed by the result
+    size_t needed = string::npos;
+    size_t newline = string::npos;
+    char buffer[65536];
+    while (true)
+    {
+        if (needed == string::npos)
+        {
+            newline = pending.find('\n');
+            if (newline != string::npos)
+            {
+                needed = newline + 1 + stoul(pending.substr(0, newline));
+            }
+        }
+        if (needed != string::npos && pending.size() >= needed)
+        {
+            if (answer != nullptr)
+            {
+                answer->assign(pending, newline + 1, needed - newline - 1);
+            }
+            pending.erase(0, needed);
+            return true;
+        }
+        ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+        if (count <= 0)
+        {
+            return false;
+        }
+        pending.append(buffer, static_cast<size_t>(count));
+    }
+}
+
+int print_answers(const string &socket_path, const vector<string> &commands)
+{
+    /*
+     * Function: print_answers
+     * Parameters: const string& socket_path, const vector<string>& commands
+     * Purpose: Sends the commands in order on one connection and prints
+     * every answer as the prompt would.
+     */
+    int fd = connect_to(socket_path);
+    if (fd < 0)
+    {
+        cout << "Error: cannot connect to " << socket_path << endl;
+        return EXIT_FAILURE;
+    }
+    string pending, answer;
+    for (const string &command : commands)
+    {
+        if (!request(fd, command, pending, &answer))
+        {
+            close(fd);
+            cout << "Error: no answer to " << command << endl;
+            return EXIT_FAILURE;
+        }
+        cout << answer;
+    }
+    close(fd);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cout << "Usage: " << argv[0] << " <socket> [connections] [requests] [command file]" << endl
+             << "       " << argv[0] << " <socket> --print <command file>" << endl;
+        return EXIT_FAILURE;
+    }
+    string socket_path = argv[1];
+    bool print = argc > 3 && string(argv[2]) == "--print";
+    unsigned connection_count = argc > 2 && !print ? static_cast<unsigned>(stoul(argv[2])) : 8;
+    size_t request_count = argc > 3 && !print ? stoul(argv[3]) : 10000;
+    const char *command_file = print ? argv[3] : argc > 4 ? argv[4] : nullptr;
+
+    vector<string> commands;
+    if (command_file != nullptr)
+    {
+        ifstream file(command_file);
+        if (!file.is_open())
+        {
+            cout << "Error: command file cannot be opened" << endl;
+            return EXIT_FAILURE;
+        }
+        string line;
+        while (getline(file, line))
+        {
+            if (!line.empty())
+            {
+                commands.push_back(line);
+            }
+        }
+    }
+    if (print)
+    {
+        return print_answers(socket_path, commands);
+    }
+    if (commands.empty())
+    {
+        commands.push_back("libraries");
+    }
+
+    // Every connection records the latency of each of its requests.
+    // Flags are chars, as the bits of vector<bool> cannot be written
+    // from several threads.
+    vector<vector<double>> latencies(connection_count);
+    vector<char> failed(connection_count, false);
+    vector<thread> clients;
+    auto start = chrono::steady_clock::now();
+    for (unsigned client = 0; client < connection_count; client++)
+    {
+        clients.emplace_back([&, client]()
+        {
+            int fd = connect_to(socket_path);
+            if (fd < 0)
+            {
+                failed[client] = true;
+                return;
+            }
+            string pending;
+            size_t share = request_count / connection_count +
+                           (client < request_count % connection_count ? 1 : 0);
+            latencies[client].reserve(share);
+            for (size_t i = 0; i < share; i++)
+            {
+                const string &command = commands[(client + i * connection_count) % commands.size()];
+                auto sent = chrono::steady_clock::now();
+                if (!request(fd, command, pending))
+                {
+                    failed[client] = true;
+                    break;
+                }
+                auto answered = chrono::steady_clock::now();
+                latencies[client].push_back(chrono::duration<double, micro>(answered - sent).count());
+            }
+            close(fd);
+        });
+    }
+    for (thread &client : clients)
+    {
+        client.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    vector<double> all;
+    for (const vector<double> &client : latencies)
+    {
+        all.insert(all.end(), client.begin(), client.end());
+    }
+    if (all.empty() || count(failed.begin(), failed.end(), char(true)) > 0)
+    {
+        cout << "Error: " << count(failed.begin(), failed.end(), char(true))
+             << " connections failed" << endl;
+        if (all.empty())
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    sort(all.begin(), all.end());
+
+    cout << fixed << setprecision(1);
+    cout << "requests: " << all.size() << ", connections: " << connection_count << endl;
+    cout << "p50: " << all[all.size() / 2] << " us" << endl;
+    cout << "p99: " << all[min(all.size() - 1, all.size() * 99 / 100)] << " us" << endl;
+    cout << "qps: " << all.size() / seconds << endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+/* Library Management System
+ * Implementation of the output buffer.
+ * */
+
+#include "output.hh"
+#include <cerrno>
+#include <charconv>
+#include <unistd.h>
+
+using namespace std;
+
+Output::Output(int fd, size_t threshold)
+    : fd_(fd), threshold_(threshold)
+{
+    buffer_.reserve(threshold + 4096);
+}
+
+Output::~Output()
+{
+    flush();
+}
+
+Output &Output::operator<<(string_view text)
+{
+    buffer_.append(text.data(), text.size());
+    write_if_full();
+    return *this;
+}
+
+Output &Output::operator<<(char c)
+{
+    buffer_.push_back(c);
+    write_if_full();
+    return *this;
+}
+
+Output &Output::operator<<(int value)
+{
+    char digits[16];
+    to_chars_result result = to_chars(digits, digits + sizeof(digits), value);
+    buffer_.append(digits, result.ptr);
+    write_if_full();
+    return *this;
+}
+
+void Output::flush()
+{
+    /*
+     * Function: Output::flush
+     * Parameters: -
+     * Purpose: Writes the whole buffer with as few system calls as the
+     * file descriptor allows and empties it. An in-memory output keeps
+     * its text.
+     */
+    if (fd_ < 0)
+    {
+        return;
+    }
+    size_t written = 0;
+    while (written < buffer_.size())
+    {
+        ssize_t count = write(fd_, buffer_.data() + written, buffer_.size() - written);
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            break;
+        }
+        written += static_cast<size_t>(count);
+    }
+    buffer_.clear();
+}
+
+const string &Output::str() const
+{
+    return buffer_;
+}
+
+void Output::clear()
+{
+    buffer_.clear();
+}
+
+void Output::write_if_full()
+{
+    if (fd_ >= 0 && buffer_.size() >= threshold_)
+    {
+        flush();
+    }
+}
@@ -0,0 +1,48 @@
+/* Library Management System
+ * The purpose of this header file is to define the output buffer the
+ * commands write to. Text is formatted into one reusable buffer that
+ * is written out once per command, or earlier if it grows past a
+ * threshold, instead of flushing the stream after every line.
+ * */
+
+#ifndef OUTPUT_HH
+#define OUTPUT_HH
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+class Output
+{
+public:
+    // Keeps everything in memory until the owner takes it with str().
+    Output() = default;
+
+    // Writes to the file descriptor whenever more than threshold bytes
+    // are buffered and on flush().
+    explicit Output(int fd, std::size_t threshold = 64 * 1024);
+
+    Output(const Output &) = delete;
+    Output &operator=(const Output &) = delete;
+    ~Output();
+
+    Output &operator<<(std::string_view text);
+    Output &operator<<(char c);
+    Output &operator<<(int value);
+
+    // Writes the buffered text to the file descriptor, if there is one.
+    void flush();
+
+    // Buffered text of an in-memory output.
+    const std::string &str() const;
+    void clear();
+
+private:
+    void write_if_full();
+
+    std::string buffer_;
+    int fd_ = -1;
+    std::size_t threshold_ = 0;
+};
+
+#endif // OUTPUT_HH
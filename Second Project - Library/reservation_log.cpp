@@ -0,0 +1,298 @@
+/* Library Management System
+ * Implementation of the reservation log. The file is a magic number
+ * followed by records that name the book they change. Records are
+ * written with single O_APPEND writes, so concurrent threads never
+ * interleave and a crash can only cut off the last record.
+ * */
+
+#include "reservation_log.hh"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Bump the version whenever the record layout changes.
+    const char log_magic[8] = {'L', 'I', 'B', 'L', 'O', 'G', '2', '\0'};
+
+    // Start of every record. The library, author and title follow it
+    // without terminators; size counts the whole record.
+    struct RecordHead
+    {
+        uint32_t size;
+        int32_t delta;
+        // Which copy of the title the author entry holds, from 0
+        uint16_t copy;
+        uint16_t library_size;
+        uint16_t author_size;
+        uint16_t title_size;
+    };
+
+    uint32_t find_copy(const Catalog &catalog, const string_view &library_name,
+                       const string_view &author, const string_view &title, uint16_t copy)
+    {
+        /*
+         * Function: find_copy
+         * Parameters: const Catalog& catalog, const string_view& library_name,
+         * const string_view& author, const string_view& title, uint16_t copy
+         * Purpose: Returns the book a record names, or npos if the
+         * catalog no longer holds it.
+         */
+        uint32_t library = catalog.find_library(library_name);
+        uint32_t title_id = catalog.find_string(title);
+        if (library == Catalog::npos || title_id == Catalog::npos)
+        {
+            return Catalog::npos;
+        }
+        uint32_t author_entry = catalog.find_author(library, catalog.find_string(author));
+        if (author_entry == Catalog::npos)
+        {
+            return Catalog::npos;
+        }
+        for (uint32_t book = catalog.books_begin(author_entry);
+             book < catalog.books_end(author_entry); book++)
+        {
+            if (catalog.title_id(book) == title_id && copy-- == 0)
+            {
+                return book;
+            }
+        }
+        return Catalog::npos;
+    }
+}
+
+ReservationLog::~ReservationLog()
+{
+    if (fd_ >= 0)
+    {
+        close(fd_);
+    }
+}
+
+bool ReservationLog::open(const string &file_name, Catalog &catalog)
+{
+    /*
+     * Function: ReservationLog::open
+     * Parameters: const string& file_name, Catalog& catalog
+     * Purpose: Remembers where the log lives and applies every complete
+     * record of the log to the catalog. A missing log is fine.
+     */
+    file_name_ = file_name;
+    catalog_ = &catalog;
+    length_ = 0;
+    foreign_ = false;
+
+    int fd = ::open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return errno == ENOENT;
+    }
+    bool result = replay(fd);
+    close(fd);
+    if (foreign_)
+    {
+        cerr << "Warning: " << file_name << " is not a reservation log and is ignored" << endl;
+    }
+    return result;
+}
+
+bool ReservationLog::replay(int fd)
+{
+    /*
+     * Function: ReservationLog::replay
+     * Parameters: int fd
+     * Purpose: Checks the magic number and adds the complete records
+     * after the ones already applied to the catalog. A change is only
+     * applied if its book still exists and its count stays reservable;
+     * the others are counted and reported.
+     */
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    if (size == 0 && length_ == 0)
+    {
+        return true;
+    }
+    char magic[sizeof(log_magic)];
+    if (size < sizeof(magic) || pread(fd, magic, sizeof(magic), 0) != sizeof(magic) ||
+        memcmp(magic, log_magic, sizeof(magic)) != 0)
+    {
+        // Records of it were applied before if the file was replaced
+        foreign_ = length_ == 0;
+        return foreign_;
+    }
+    if (size < length_)
+    {
+        return false;
+    }
+
+    size_t start = max(length_, sizeof(log_magic));
+    vector<char> data(size - start);
+    if (!data.empty() && pread(fd, data.data(), data.size(), static_cast<off_t>(start)) !=
+                             static_cast<ssize_t>(data.size()))
+    {
+        return false;
+    }
+
+    size_t position = 0;
+    size_t skipped = 0;
+    RecordHead head;
+    while (data.size() - position >= sizeof(head))
+    {
+        memcpy(&head, data.data() + position, sizeof(head));
+        if (head.size != sizeof(head) + head.library_size + head.author_size + head.title_size)
+        {
+            // Not written by this program; keep the file for a person to look at
+            foreign_ = length_ == 0 && position == 0;
+            return foreign_;
+        }
+        if (data.size() - position < head.size)
+        {
+            // Cut off by a crash, dropped when the log is next written
+            break;
+        }
+        const char *text = data.data() + position + sizeof(head);
+        string_view library_name(text, head.library_size);
+        string_view author(text + head.library_size, head.author_size);
+        string_view title(text + head.library_size + head.author_size, head.title_size);
+        uint32_t book = find_copy(*catalog_, library_name, author, title, head.copy);
+        int current = book == Catalog::npos ? 100 : catalog_->reservations(book);
+        if (current != 100 && current + head.delta >= 0 && current + head.delta < 100)
+        {
+            catalog_->add_reservations(book, head.delta);
+        }
+        else
+        {
+            skipped++;
+        }
+        position += head.size;
+    }
+    length_ = start + position;
+
+    if (skipped > 0)
+    {
+        cerr << "Warning: " << skipped << " reservation changes in " << file_name_
+             << " no longer match the input file and were skipped" << endl;
+    }
+    return true;
+}
+
+bool ReservationLog::writable()
+{
+    /*
+     * Function: ReservationLog::writable
+     * Parameters: -
+     * Purpose: Opens the log for appending unless that is done already.
+     * Only the holder of the exclusive lock truncates the file, so an
+     * incomplete last record is dropped without losing records of
+     * another writer. A foreign file is moved aside, never truncated.
+     */
+    if (fd_.load(memory_order_acquire) >= 0)
+    {
+        return true;
+    }
+    lock_guard<mutex> lock(open_mutex_);
+    if (fd_.load(memory_order_relaxed) >= 0)
+    {
+        return true;
+    }
+    if (catalog_ == nullptr)
+    {
+        return false;
+    }
+
+    int fd = ::open(file_name_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd >= 0 && (flock(fd, LOCK_EX | LOCK_NB) != 0 || !replay(fd)))
+    {
+        close(fd);
+        return false;
+    }
+    if (fd >= 0 && foreign_)
+    {
+        string old_name = file_name_ + ".old";
+        close(fd);
+        if (rename(file_name_.c_str(), old_name.c_str()) != 0)
+        {
+            return false;
+        }
+        cerr << "Warning: " << file_name_ << " was moved to " << old_name << endl;
+        foreign_ = false;
+        fd = ::open(file_name_.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd >= 0 && flock(fd, LOCK_EX | LOCK_NB) != 0)
+        {
+            close(fd);
+            return false;
+        }
+    }
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (length_ == 0)
+    {
+        if (pwrite(fd, log_magic, sizeof(log_magic), 0) != sizeof(log_magic))
+        {
+            close(fd);
+            return false;
+        }
+        length_ = sizeof(log_magic);
+    }
+    if (ftruncate(fd, static_cast<off_t>(length_)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    int flags = fcntl(fd, F_GETFL);
+    fcntl(fd, F_SETFL, flags | O_APPEND);
+    fd_.store(fd, memory_order_release);
+    return true;
+}
+
+bool ReservationLog::append(uint32_t library, uint32_t author, uint32_t book, int delta)
+{
+    /*
+     * Function: ReservationLog::append
+     * Parameters: uint32_t library, uint32_t author, uint32_t book, int delta
+     * Purpose: Writes one record naming the book by its library,
+     * author, title and copy number.
+     */
+    string_view library_name = catalog_->library_name(library);
+    string_view author_name = catalog_->string_at(catalog_->author_id(author));
+    string_view title = catalog_->string_at(catalog_->title_id(book));
+    if (library_name.size() > UINT16_MAX || author_name.size() > UINT16_MAX ||
+        title.size() > UINT16_MAX)
+    {
+        return false;
+    }
+
+    RecordHead head = {};
+    head.delta = delta;
+    for (uint32_t other = catalog_->books_begin(author); other < book; other++)
+    {
+        head.copy += catalog_->title_id(other) == catalog_->title_id(book) ? 1 : 0;
+    }
+    head.library_size = static_cast<uint16_t>(library_name.size());
+    head.author_size = static_cast<uint16_t>(author_name.size());
+    head.title_size = static_cast<uint16_t>(title.size());
+    head.size = static_cast<uint32_t>(sizeof(head) + library_name.size() +
+                                      author_name.size() + title.size());
+
+    string record(reinterpret_cast<const char *>(&head), sizeof(head));
+    record += library_name;
+    record += author_name;
+    record += title;
+    return writable() && write(fd_, record.data(), record.size()) ==
+                             static_cast<ssize_t>(record.size());
+}
@@ -0,0 +1,66 @@
+/* Library Management System
+ * The purpose of this header file is to define the append-only log
+ * that makes reservation changes survive a restart. The log records
+ * which book changed, by library, author, title and copy, and by how
+ * much; at startup the records are looked up again and added on top of
+ * the counts read from the CSV or the snapshot. Touching, copying or
+ * editing the CSV therefore keeps the changes of every book that is
+ * still in it.
+ *
+ * The file is only created once a reservation changes, so read-only
+ * sessions never write next to the input file. The process that
+ * writes holds an exclusive lock on the log for as long as it runs;
+ * other processes can still read it but not write it.
+ * */
+
+#ifndef RESERVATION_LOG_HH
+#define RESERVATION_LOG_HH
+
+#include "catalog.hh"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+class ReservationLog
+{
+public:
+    ReservationLog() = default;
+    ReservationLog(const ReservationLog &) = delete;
+    ReservationLog &operator=(const ReservationLog &) = delete;
+    ~ReservationLog();
+
+    // Replays an existing log into the catalog without writing to it.
+    // Changes of books no longer in the catalog are skipped with a
+    // warning. Returns false if the file exists but cannot be read.
+    bool open(const std::string &file_name, Catalog &catalog);
+
+    // Opens the log for appending on first use: creates the file, locks
+    // it and replays records another process appended since open(). A
+    // file that is not a log of this format is renamed to
+    // <file>.old instead of being overwritten. Safe to call from
+    // several threads. Returns false if the file cannot be written or
+    // another process is writing it.
+    bool writable();
+
+    // Appends one change of a book of the given library and author
+    // entry. Safe to call from several threads. Returns false if the
+    // log is not writable or the record could not be written.
+    bool append(std::uint32_t library, std::uint32_t author, std::uint32_t book, int delta);
+
+private:
+    // Applies the complete records past length_ to the catalog.
+    bool replay(int fd);
+
+    std::string file_name_;
+    Catalog *catalog_ = nullptr;
+    // Bytes of the log already applied, 0 if no log was read
+    std::size_t length_ = 0;
+    // The file exists but is not a log of this format
+    bool foreign_ = false;
+
+    std::mutex open_mutex_;
+    std::atomic<int> fd_{-1};
+};
+
+#endif // RESERVATION_LOG_HH
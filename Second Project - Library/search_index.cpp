@@ -0,0 +1,386 @@
+/* Library Management System
+ * Implementation of the prefix and fuzzy search index.
+ * */
+
+#include "search_index.hh"
+#include <algorithm>
+#include <cctype>
+#include <csignal>
+
+using namespace std;
+
+namespace
+{
+    // Candidates below this trigram similarity are not reported
+    const double minimum_similarity = 0.3;
+
+    // How many of the most similar strings are ranked by edit distance
+    const size_t ranked_candidates = 64;
+
+    // Thrown out of a build that was cancelled
+    struct BuildCancelled
+    {
+    };
+
+    string to_lowercase(string_view text)
+    {
+        string result(text);
+        for (char &c : result)
+        {
+            c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        }
+        return result;
+    }
+
+    void trigrams_of(const string &lowercase, vector<uint32_t> &keys)
+    {
+        /*
+         * Function: trigrams_of
+         * Parameters: const string& lowercase, vector<uint32_t>& keys
+         * Purpose: Stores the distinct trigrams of a lowercase string in
+         * keys as sorted 24-bit keys. The text is padded with two spaces
+         * in front and one behind, so short strings and word starts count.
+         */
+        keys.clear();
+        uint32_t window = static_cast<uint32_t>(' ') << 8 | ' ';
+        for (size_t i = 0; i <= lowercase.size(); i++)
+        {
+            unsigned char next = i < lowercase.size() ? static_cast<unsigned char>(lowercase[i]) : ' ';
+            window = (window << 8 | next) & 0xFFFFFF;
+            keys.push_back(window);
+        }
+        sort(keys.begin(), keys.end());
+        keys.erase(unique(keys.begin(), keys.end()), keys.end());
+    }
+
+    size_t edit_distance(const string &text, const string &target)
+    {
+        /*
+         * Function: edit_distance
+         * Parameters: const string& text, const string& target
+         * Purpose: Levenshtein distance between the text and the most
+         * similar part of the target, so a partial title or author is
+         * not penalized for the words it leaves out. Computed with two
+         * rows of the dynamic programming table.
+         */
+        vector<size_t> previous(target.size() + 1, 0), current(target.size() + 1);
+        for (size_t i = 1; i <= text.size(); i++)
+        {
+            current[0] = i;
+            for (size_t j = 1; j <= target.size(); j++)
+            {
+                size_t substitution = previous[j - 1] + (text[i - 1] == target[j - 1] ? 0 : 1);
+                current[j] = min(min(previous[j], current[j - 1]) + 1, substitution);
+            }
+            swap(previous, current);
+        }
+        return *min_element(previous.begin(), previous.end());
+    }
+}
+
+SearchIndex::SearchIndex(const Catalog &catalog)
+    : catalog_(catalog)
+{
+}
+
+SearchIndex::~SearchIndex()
+{
+    // A background build stops at its next check instead of finishing
+    cancelled_.store(true, memory_order_relaxed);
+    if (builder_.joinable())
+    {
+        builder_.join();
+    }
+}
+
+void SearchIndex::build_in_background()
+{
+    /*
+     * Function: SearchIndex::build_in_background
+     * Parameters: -
+     * Purpose: Starts building the index on its own thread. The thread
+     * blocks all signals, so a server that takes SIGINT and SIGTERM
+     * through a signalfd still receives them. A cancelled build leaves
+     * the index unbuilt.
+     */
+    if (builder_.joinable())
+    {
+        return;
+    }
+    sigset_t all_signals, previous;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_BLOCK, &all_signals, &previous);
+    builder_ = thread([this]()
+    {
+        try
+        {
+            call_once(built_, [this]() { build(); });
+        }
+        catch (const BuildCancelled &)
+        {
+        }
+    });
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+}
+
+void SearchIndex::build() const
+{
+    /*
+     * Function: SearchIndex::build
+     * Parameters: -
+     * Purpose: Collects the distinct books, their authors and titles,
+     * and builds the prefix order and the trigram posting lists. Checks
+     * between the steps whether the index is being destroyed.
+     */
+    auto check_cancelled = [this]()
+    {
+        if (cancelled_.load(memory_order_relaxed))
+        {
+            throw BuildCancelled();
+        }
+    };
+
+    for (uint32_t author = 0; author < catalog_.author_count(); author++)
+    {
+        check_cancelled();
+        for (uint32_t book = catalog_.books_begin(author); book < catalog_.books_end(author); book++)
+        {
+            works_by_author_.emplace_back(catalog_.author_id(author), catalog_.title_id(book));
+        }
+    }
+    check_cancelled();
+    sort(works_by_author_.begin(), works_by_author_.end());
+    works_by_author_.erase(unique(works_by_author_.begin(), works_by_author_.end()),
+                           works_by_author_.end());
+    works_by_title_ = works_by_author_;
+    sort(works_by_title_.begin(), works_by_title_.end(), [](const Work &a, const Work &b)
+    {
+        return make_pair(a.second, a.first) < make_pair(b.second, b.first);
+    });
+
+    // Library names are not searchable, only authors and titles
+    check_cancelled();
+    for (const Work &work : works_by_author_)
+    {
+        string_ids_.push_back(work.first);
+        string_ids_.push_back(work.second);
+    }
+    sort(string_ids_.begin(), string_ids_.end());
+    string_ids_.erase(unique(string_ids_.begin(), string_ids_.end()), string_ids_.end());
+
+    // Trigram in the high and position in the low half, so one integer
+    // sort groups the posting lists
+    vector<uint64_t> trigram_positions;
+    vector<uint32_t> keys;
+    lowercase_.reserve(string_ids_.size());
+    trigram_counts_.reserve(string_ids_.size());
+    for (uint32_t position = 0; position < string_ids_.size(); position++)
+    {
+        if (position % 4096 == 0)
+        {
+            check_cancelled();
+        }
+        lowercase_.push_back(to_lowercase(catalog_.string_at(string_ids_[position])));
+        trigrams_of(lowercase_.back(), keys);
+        trigram_counts_.push_back(static_cast<uint32_t>(keys.size()));
+        for (uint32_t key : keys)
+        {
+            trigram_positions.push_back(static_cast<uint64_t>(key) << 32 | position);
+        }
+    }
+
+    check_cancelled();
+    prefix_order_.resize(string_ids_.size());
+    for (uint32_t position = 0; position < prefix_order_.size(); position++)
+    {
+        prefix_order_[position] = position;
+    }
+    sort(prefix_order_.begin(), prefix_order_.end(), [this](uint32_t a, uint32_t b)
+    {
+        return lowercase_[a] < lowercase_[b];
+    });
+
+    // Positions were added in increasing order, so a stable radix sort
+    // on the 24 trigram bits, 12 bits per pass, leaves every posting
+    // list sorted
+    vector<uint64_t> sorted(trigram_positions.size());
+    vector<size_t> starts(4097);
+    for (int shift = 32; shift < 56; shift += 12)
+    {
+        check_cancelled();
+        fill(starts.begin(), starts.end(), 0);
+        for (uint64_t value : trigram_positions)
+        {
+            starts[((value >> shift) & 0xFFF) + 1]++;
+        }
+        for (size_t digit = 1; digit < starts.size(); digit++)
+        {
+            starts[digit] += starts[digit - 1];
+        }
+        for (uint64_t value : trigram_positions)
+        {
+            sorted[starts[(value >> shift) & 0xFFF]++] = value;
+        }
+        trigram_positions.swap(sorted);
+    }
+    vector<uint64_t>().swap(sorted);
+    postings_.reserve(trigram_positions.size());
+    for (size_t i = 0; i < trigram_positions.size(); i++)
+    {
+        uint32_t key = static_cast<uint32_t>(trigram_positions[i] >> 32);
+        if (trigram_keys_.empty() || trigram_keys_.back() != key)
+        {
+            trigram_keys_.push_back(key);
+            posting_offsets_.push_back(static_cast<uint32_t>(postings_.size()));
+        }
+        postings_.push_back(static_cast<uint32_t>(trigram_positions[i]));
+    }
+    posting_offsets_.push_back(static_cast<uint32_t>(postings_.size()));
+}
+
+void SearchIndex::add_works(uint32_t position, vector<Work> &works, size_t limit) const
+{
+    /*
+     * Function: SearchIndex::add_works
+     * Parameters: uint32_t position, vector<Work>& works, size_t limit
+     * Purpose: Appends the books written by or titled with the string
+     * at the position, skipping books that are already listed.
+     */
+    uint32_t id = string_ids_[position];
+    auto by_author = equal_range(works_by_author_.begin(), works_by_author_.end(), Work(id, 0),
+                                 [](const Work &a, const Work &b) { return a.first < b.first; });
+    auto by_title = equal_range(works_by_title_.begin(), works_by_title_.end(), Work(0, id),
+                                [](const Work &a, const Work &b) { return a.second < b.second; });
+    for (auto range : {by_author, by_title})
+    {
+        for (auto iter = range.first; iter != range.second && works.size() < limit; ++iter)
+        {
+            if (find(works.begin(), works.end(), *iter) == works.end())
+            {
+                works.push_back(*iter);
+            }
+        }
+    }
+}
+
+vector<Work> SearchIndex::prefix(string_view text, size_t limit) const
+{
+    /*
+     * Function: SearchIndex::prefix
+     * Parameters: string_view text, size_t limit
+     * Purpose: Binary searches the lowercase order for the first string
+     * with the prefix and collects books until the limit is reached.
+     */
+    call_once(built_, [this]() { build(); });
+
+    string lowercase = to_lowercase(text);
+    auto iter = lower_bound(prefix_order_.begin(), prefix_order_.end(), lowercase,
+                            [this](uint32_t position, const string &value)
+    {
+        return lowercase_[position] < value;
+    });
+
+    vector<Work> works;
+    for (; iter != prefix_order_.end() && works.size() < limit; ++iter)
+    {
+        if (lowercase_[*iter].compare(0, lowercase.size(), lowercase) != 0)
+        {
+            break;
+        }
+        add_works(*iter, works, limit);
+    }
+    return works;
+}
+
+vector<Work> SearchIndex::fuzzy(string_view text, size_t limit) const
+{
+    /*
+     * Function: SearchIndex::fuzzy
+     * Parameters: string_view text, size_t limit
+     * Purpose: Counts the trigrams every string shares with the text by
+     * walking the posting lists of the text's trigrams. Strings are
+     * scored with the Dice coefficient and the best ones are ranked by
+     * edit distance before their books are collected.
+     */
+    call_once(built_, [this]() { build(); });
+
+    string lowercase = to_lowercase(text);
+    vector<uint32_t> keys;
+    trigrams_of(lowercase, keys);
+
+    // Shared trigram counts per position. The array is kept between
+    // calls of the same thread and only touched entries are reset.
+    thread_local vector<uint16_t> shared;
+    thread_local vector<uint32_t> touched;
+    if (shared.size() < string_ids_.size())
+    {
+        shared.assign(string_ids_.size(), 0);
+    }
+    touched.clear();
+
+    for (uint32_t key : keys)
+    {
+        auto iter = lower_bound(trigram_keys_.begin(), trigram_keys_.end(), key);
+        if (iter == trigram_keys_.end() || *iter != key)
+        {
+            continue;
+        }
+        size_t list = static_cast<size_t>(iter - trigram_keys_.begin());
+        for (uint32_t i = posting_offsets_[list]; i < posting_offsets_[list + 1]; i++)
+        {
+            uint32_t position = postings_[i];
+            if (shared[position]++ == 0)
+            {
+                touched.push_back(position);
+            }
+        }
+    }
+
+    struct Candidate
+    {
+        double similarity;
+        size_t distance;
+        uint32_t position;
+    };
+    vector<Candidate> candidates;
+    for (uint32_t position : touched)
+    {
+        double similarity = 2.0 * shared[position] / (keys.size() + trigram_counts_[position]);
+        shared[position] = 0;
+        if (similarity >= minimum_similarity)
+        {
+            candidates.push_back({similarity, 0, position});
+        }
+    }
+
+    auto by_similarity = [](const Candidate &a, const Candidate &b)
+    {
+        if (a.similarity != b.similarity)
+        {
+            return a.similarity > b.similarity;
+        }
+        return a.position < b.position;
+    };
+    size_t ranked = min(candidates.size(), ranked_candidates);
+    partial_sort(candidates.begin(), candidates.begin() + ranked, candidates.end(), by_similarity);
+    candidates.resize(ranked);
+    for (Candidate &candidate : candidates)
+    {
+        candidate.distance = edit_distance(lowercase, lowercase_[candidate.position]);
+    }
+    stable_sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b)
+    {
+        return a.distance < b.distance;
+    });
+
+    vector<Work> works;
+    for (const Candidate &candidate : candidates)
+    {
+        if (works.size() >= limit)
+        {
+            break;
+        }
+        add_works(candidate.position, works, limit);
+    }
+    return works;
+}
@@ -0,0 +1,78 @@
+/* Library Management System
+ * The purpose of this header file is to define the search index that
+ * finds books from a mistyped or partial title or author. The index
+ * covers every distinct author and title of the catalog:
+ *
+ * - prefix search uses the strings sorted by their lowercase form;
+ * - fuzzy search uses trigram posting lists and ranks the candidates
+ *   by trigram similarity and edit distance.
+ *
+ * The index is built by the first search, so a catalog mapped from a
+ * snapshot still starts instantly. A server builds it on a background
+ * thread right away instead; a search that arrives before that build is
+ * done waits for it, and destroying the index cancels it.
+ * */
+
+#ifndef SEARCH_INDEX_HH
+#define SEARCH_INDEX_HH
+
+#include "catalog.hh"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A book as a pair of author and title string ids.
+using Work = std::pair<std::uint32_t, std::uint32_t>;
+
+class SearchIndex
+{
+public:
+    explicit SearchIndex(const Catalog &catalog);
+    ~SearchIndex();
+
+    // Builds the index on a background thread. The catalog must not be
+    // moved or destroyed before the index.
+    void build_in_background();
+
+    // Books whose author or title starts with the text, ignoring case,
+    // in alphabetical order of the matching string.
+    std::vector<Work> prefix(std::string_view text, std::size_t limit) const;
+
+    // Books whose author or title resembles the text, best match first.
+    std::vector<Work> fuzzy(std::string_view text, std::size_t limit) const;
+
+private:
+    void build() const;
+    void add_works(std::uint32_t position, std::vector<Work> &works, std::size_t limit) const;
+
+    const Catalog &catalog_;
+    mutable std::once_flag built_;
+    std::thread builder_;
+    std::atomic<bool> cancelled_{false};
+
+    // Distinct books sorted by author and by title
+    mutable std::vector<Work> works_by_author_;
+    mutable std::vector<Work> works_by_title_;
+
+    // Searchable strings. A position indexes all of these arrays.
+    mutable std::vector<std::uint32_t> string_ids_;
+    mutable std::vector<std::string> lowercase_;
+    mutable std::vector<std::uint32_t> trigram_counts_;
+
+    // Positions sorted by lowercase text
+    mutable std::vector<std::uint32_t> prefix_order_;
+
+    // Posting lists: positions containing trigram_keys_[i] are
+    // postings_[posting_offsets_[i]] to postings_[posting_offsets_[i + 1]]
+    mutable std::vector<std::uint32_t> trigram_keys_;
+    mutable std::vector<std::uint32_t> posting_offsets_;
+    mutable std::vector<std::uint32_t> postings_;
+};
+
+#endif // SEARCH_INDEX_HH
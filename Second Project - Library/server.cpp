@@ -0,0 +1,424 @@
+/* Library Management System
+ * Implementation of the socket server. One thread runs an epoll loop
+ * that accepts connections and notices readable sockets; a pool of
+ * worker threads reads the commands and writes the answers. Workers
+ * never block on a socket: answers a client does not take at once stay
+ * with the connection until the socket is writable again. The
+ * catalog structure is never modified while serving and reservation
+ * counts are atomics, so the workers share it without any locking.
+ * */
+
+#include "server.hh"
+#include "commands.hh"
+#include <algorithm>
+#include <condition_variable>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Longest command line accepted and the most answer text kept
+    // waiting for a client that does not read fast enough.
+    const size_t max_line_length = 64 * 1024;
+    const size_t max_unsent = 1024 * 1024;
+
+    // One client connection. EPOLLONESHOT guarantees that at most one
+    // worker handles a connection at a time, so its state needs no lock.
+    struct Connection
+    {
+        int fd = -1;
+        string input;
+        Output output;
+        // Answers not yet accepted by the socket, from position sent on
+        string unsent;
+        size_t sent = 0;
+        bool peer_closed = false;
+    };
+
+    // What a connection waits for when a worker is done with it.
+    enum class Next
+    {
+        read,
+        write,
+        close
+    };
+
+    // Connections that have data waiting, handed from the event loop
+    // to the workers.
+    class WorkQueue
+    {
+    public:
+        void push(Connection *connection)
+        {
+            {
+                lock_guard<mutex> lock(mutex_);
+                connections_.push_back(connection);
+            }
+            ready_.notify_one();
+        }
+
+        // Returns false once the queue is stopped.
+        bool pop(Connection *&connection)
+        {
+            unique_lock<mutex> lock(mutex_);
+            ready_.wait(lock, [this]() { return stopped_ || !connections_.empty(); });
+            if (stopped_)
+            {
+                return false;
+            }
+            connection = connections_.front();
+            connections_.pop_front();
+            return true;
+        }
+
+        void stop()
+        {
+            {
+                lock_guard<mutex> lock(mutex_);
+                stopped_ = true;
+            }
+            ready_.notify_all();
+        }
+
+    private:
+        mutex mutex_;
+        condition_variable ready_;
+        deque<Connection *> connections_;
+        bool stopped_ = false;
+    };
+
+    bool send_unsent(Connection &connection)
+    {
+        /*
+         * Function: send_unsent
+         * Parameters: Connection& connection
+         * Purpose: Writes as much of the unsent answers as the socket
+         * takes without blocking. Returns false if the socket failed.
+         */
+        while (connection.sent < connection.unsent.size())
+        {
+            ssize_t count = send(connection.fd, connection.unsent.data() + connection.sent,
+                                 connection.unsent.size() - connection.sent, MSG_NOSIGNAL);
+            if (count > 0)
+            {
+                connection.sent += static_cast<size_t>(count);
+            }
+            else if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else
+            {
+                return count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+            }
+        }
+        connection.unsent.clear();
+        connection.sent = 0;
+        return true;
+    }
+
+    bool answer_commands(Connection &connection, Catalog &catalog, ReservationLog &log,
+                         const SearchIndex &index)
+    {
+        /*
+         * Function: answer_commands
+         * Parameters: Connection& connection, Catalog& catalog,
+         * ReservationLog& log, const SearchIndex& index
+         * Purpose: Answers the complete command lines received so far,
+         * stopping early once max_unsent bytes wait to be sent. Returns
+         * false if a command ends the session.
+         */
+        size_t start = 0;
+        size_t end;
+        while (connection.unsent.size() < max_unsent &&
+               (end = connection.input.find('\n', start)) != string::npos)
+        {
+            string command = connection.input.substr(start, end - start);
+            start = end + 1;
+            if (!command.empty() && command.back() == '\r')
+            {
+                command.pop_back();
+            }
+
+            // The output buffer is reused for every command of the connection
+            connection.output.clear();
+            if (!execute_command(command, catalog, log, index, connection.output))
+            {
+                return false;
+            }
+            connection.unsent += to_string(connection.output.str().size());
+            connection.unsent += '\n';
+            connection.unsent += connection.output.str();
+        }
+        connection.input.erase(0, start);
+        return true;
+    }
+
+    Next serve_connection(Connection &connection, Catalog &catalog, ReservationLog &log,
+                          const SearchIndex &index)
+    {
+        /*
+         * Function: serve_connection
+         * Parameters: Connection& connection, Catalog& catalog,
+         * ReservationLog& log, const SearchIndex& index
+         * Purpose: Sends pending answers, answers complete command lines
+         * and reads more input, never blocking on the socket. Returns
+         * what the connection has to wait for next.
+         */
+        char buffer[4096];
+        while (true)
+        {
+            if (!send_unsent(connection))
+            {
+                return Next::close;
+            }
+            if (!connection.unsent.empty())
+            {
+                return Next::write;
+            }
+            if (!answer_commands(connection, catalog, log, index))
+            {
+                return Next::close;
+            }
+            if (!connection.unsent.empty())
+            {
+                continue;
+            }
+
+            // Everything received is answered, so more input is needed.
+            // A client that closed its end has had all its answers.
+            if (connection.peer_closed || connection.input.size() >= max_line_length)
+            {
+                return Next::close;
+            }
+            size_t room = min(sizeof(buffer), max_line_length - connection.input.size());
+            ssize_t count = recv(connection.fd, buffer, room, 0);
+            if (count > 0)
+            {
+                connection.input.append(buffer, static_cast<size_t>(count));
+            }
+            else if (count == 0)
+            {
+                connection.peer_closed = true;
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return Next::read;
+            }
+            else if (errno != EINTR)
+            {
+                return Next::close;
+            }
+        }
+    }
+
+    bool remove_stale_socket(const string &socket_path, const sockaddr_un &address)
+    {
+        /*
+         * Function: remove_stale_socket
+         * Parameters: const string& socket_path, const sockaddr_un& address
+         * Purpose: Makes the path free for binding. Only a socket left
+         * behind by a server that no longer runs is removed; any other
+         * file, or a socket some server still accepts on, is kept and
+         * false is returned.
+         */
+        struct stat info;
+        if (lstat(socket_path.c_str(), &info) != 0)
+        {
+            return errno == ENOENT;
+        }
+        if (!S_ISSOCK(info.st_mode))
+        {
+            return false;
+        }
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (probe < 0)
+        {
+            return false;
+        }
+        bool live = connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0 ||
+                    errno != ECONNREFUSED;
+        close(probe);
+        return !live && unlink(socket_path.c_str()) == 0;
+    }
+
+    int open_listener(const string &socket_path)
+    {
+        /*
+         * Function: open_listener
+         * Parameters: const string& socket_path
+         * Purpose: Creates a non-blocking Unix domain socket listening
+         * on the given path. Returns -1 on failure.
+         */
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (socket_path.size() >= sizeof(address.sun_path))
+        {
+            return -1;
+        }
+        memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+        if (!remove_stale_socket(socket_path, address))
+        {
+            return -1;
+        }
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+            listen(fd, SOMAXCONN) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+}
+
+int run_server(const string &socket_path, Catalog &catalog, ReservationLog &log,
+               const SearchIndex &index, unsigned worker_count)
+{
+    /*
+     * Function: run_server
+     * Parameters: const string& socket_path, Catalog& catalog,
+     * ReservationLog& log, const SearchIndex& index, unsigned worker_count
+     * Purpose: Accepts clients on the socket and answers their commands
+     * with a pool of worker threads until SIGINT or SIGTERM arrives.
+     */
+
+    // Deliver the stop signals through a descriptor the event loop
+    // watches. The mask is inherited by the worker threads.
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+    int signal_fd = signalfd(-1, &stop_signals, SFD_CLOEXEC);
+
+    int listen_fd = open_listener(socket_path);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (signal_fd < 0 || listen_fd < 0 || epoll_fd < 0)
+    {
+        cout << "Error: cannot listen on " << socket_path << endl;
+        return EXIT_FAILURE;
+    }
+
+    // The listener and the signal descriptor are told apart from
+    // connections by the address stored with them.
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = &listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    event.data.ptr = &signal_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &event);
+
+    mutex connections_mutex;
+    unordered_set<Connection *> connections;
+    WorkQueue queue;
+
+    vector<thread> workers;
+    for (unsigned i = 0; i < max(worker_count, 1u); i++)
+    {
+        workers.emplace_back([&]()
+        {
+            Connection *connection;
+            while (queue.pop(connection))
+            {
+                Next next = serve_connection(*connection, catalog, log, index);
+                if (next != Next::close)
+                {
+                    // Hand the connection back to the event loop
+                    epoll_event rearm = {};
+                    rearm.events = (next == Next::write ? EPOLLOUT : EPOLLIN) |
+                                   EPOLLRDHUP | EPOLLONESHOT;
+                    rearm.data.ptr = connection;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection->fd, &rearm);
+                }
+                else
+                {
+                    {
+                        lock_guard<mutex> lock(connections_mutex);
+                        connections.erase(connection);
+                    }
+                    close(connection->fd);
+                    delete connection;
+                }
+            }
+        });
+    }
+
+    cout << "Serving on " << socket_path << " with " << workers.size() << " workers" << endl;
+
+    bool running = true;
+    vector<epoll_event> events(64);
+    while (running)
+    {
+        int count = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), -1);
+        if (count < 0 && errno != EINTR)
+        {
+            break;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            if (events[i].data.ptr == &signal_fd)
+            {
+                running = false;
+            }
+            else if (events[i].data.ptr == &listen_fd)
+            {
+                int client_fd;
+                while ((client_fd = accept4(listen_fd, nullptr, nullptr,
+                                            SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+                {
+                    Connection *connection = new Connection;
+                    connection->fd = client_fd;
+                    {
+                        lock_guard<mutex> lock(connections_mutex);
+                        connections.insert(connection);
+                    }
+                    epoll_event client = {};
+                    client.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+                    client.data.ptr = connection;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &client);
+                }
+            }
+            else
+            {
+                queue.push(static_cast<Connection *>(events[i].data.ptr));
+            }
+        }
+    }
+
+    queue.stop();
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+    for (Connection *connection : connections)
+    {
+        close(connection->fd);
+        delete connection;
+    }
+    close(epoll_fd);
+    close(listen_fd);
+    close(signal_fd);
+    unlink(socket_path.c_str());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,24 @@
+/* Library Management System
+ * The purpose of this header file is to declare the socket server
+ * that answers the library commands for many clients at once.
+ *
+ * Protocol: a client sends one command per line. For every command
+ * the server answers with the length of the result in bytes on its
+ * own line, followed by the result exactly as the prompt would print
+ * it. "quit" and "exit" close the connection.
+ * */
+
+#ifndef SERVER_HH
+#define SERVER_HH
+
+#include "catalog.hh"
+#include "reservation_log.hh"
+#include "search_index.hh"
+#include <string>
+
+// Declare a function for serving the catalog on a Unix domain socket.
+// Runs until SIGINT or SIGTERM and returns the exit status.
+int run_server(const std::string &socket_path, Catalog &catalog, ReservationLog &log,
+               const SearchIndex &index, unsigned worker_count);
+
+#endif // SERVER_HH
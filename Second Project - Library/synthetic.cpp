@@ -0,0 +1,168 @@
+/* Library Management System
+ * Implementation of the synthetic input file generator.
+ * */
+
+#include "synthetic.hh"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const char *const title_words[] = {
+        "River", "Night", "House", "Winter", "Blue", "Stone", "Garden", "Silent",
+        "King", "Ship", "War", "Love", "Dark", "City", "Song", "Glass",
+        "Forest", "Summer", "Iron", "Letters", "Island", "Mirror", "Shadow", "Bridge",
+        "Snow", "Queen", "Road", "Light", "Wolf", "Harbour", "Storm", "Empire"};
+    const size_t title_word_count = sizeof(title_words) / sizeof(title_words[0]);
+
+    string title_of(uint32_t author, uint32_t number)
+    {
+        /*
+         * Function: title_of
+         * Parameters: uint32_t author, uint32_t number
+         * Purpose: Returns the same title for the same author and number,
+         * so several libraries hold copies of one book.
+         */
+        uint64_t hash = (static_cast<uint64_t>(author) << 32 | number) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+        return string(title_words[hash % title_word_count]) + " " +
+               title_words[(hash >> 8) % title_word_count] + " " + to_string(number + 1);
+    }
+}
+
+bool set_generator_option(const string &name, const string &value, GeneratorOptions &options)
+{
+    /*
+     * Function: set_generator_option
+     * Parameters: const string& name, const string& value,
+     * GeneratorOptions& options
+     * Purpose: Sets the option with the given command line name.
+     */
+    try
+    {
+        if (name == "--rows")
+        {
+            options.rows = stoull(value);
+        }
+        else if (name == "--libraries")
+        {
+            options.libraries = static_cast<uint32_t>(max(1ul, stoul(value)));
+        }
+        else if (name == "--authors")
+        {
+            options.authors = static_cast<uint32_t>(max(1ul, stoul(value)));
+        }
+        else if (name == "--titles")
+        {
+            options.titles_per_author = static_cast<uint32_t>(max(1ul, stoul(value)));
+        }
+        else if (name == "--skew")
+        {
+            options.skew = stod(value);
+        }
+        else if (name == "--comma-share")
+        {
+            options.comma_share = stod(value);
+        }
+        else if (name == "--unreservable-share")
+        {
+            options.unreservable_share = stod(value);
+        }
+        else if (name == "--seed")
+        {
+            options.seed = static_cast<uint32_t>(stoul(value));
+        }
+        else
+        {
+            return false;
+        }
+    }
+    catch (const exception &)
+    {
+        return false;
+    }
+    return true;
+}
+
+string generator_usage()
+{
+    return "  --rows <n>                 number of lines (1000)\n"
+           "  --libraries <n>            number of libraries (20)\n"
+           "  --authors <n>              number of authors (1000)\n"
+           "  --titles <n>               titles per author (8)\n"
+           "  --skew <s>                 Zipf exponent of author popularity (1.0)\n"
+           "  --comma-share <p>          share of ',' separated lines (0.5)\n"
+           "  --unreservable-share <p>   share of books with 100 reservations (0.02)\n"
+           "  --seed <n>                 random seed (1)\n";
+}
+
+void generate_catalog(const GeneratorOptions &options, ostream &out)
+{
+    /*
+     * Function: generate_catalog
+     * Parameters: const GeneratorOptions& options, ostream& out
+     * Purpose: Writes options.rows lines. Authors are drawn from a Zipf
+     * distribution, libraries and titles uniformly. Lines are collected
+     * into a buffer and written in large blocks.
+     */
+    mt19937_64 rand_gen(options.seed);
+
+    // Cumulative author weights for sampling by binary search
+    vector<double> author_weights(options.authors);
+    double total = 0;
+    for (uint32_t author = 0; author < options.authors; author++)
+    {
+        total += 1.0 / pow(author + 1.0, options.skew);
+        author_weights[author] = total;
+    }
+
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    uniform_int_distribution<uint32_t> library_dist(0, options.libraries - 1);
+    uniform_int_distribution<uint32_t> title_dist(0, options.titles_per_author - 1);
+    uniform_int_distribution<int> reservation_dist(0, 9);
+
+    string buffer;
+    buffer.reserve(1 << 20);
+    for (uint64_t row = 0; row < options.rows; row++)
+    {
+        uint32_t author = static_cast<uint32_t>(
+            upper_bound(author_weights.begin(), author_weights.end(), unit(rand_gen) * total) -
+            author_weights.begin());
+        author = min(author, options.authors - 1);
+        char delimiter = unit(rand_gen) < options.comma_share ? ',' : ';';
+
+        string reservations;
+        if (unit(rand_gen) < options.unreservable_share)
+        {
+            reservations = "100";
+        }
+        else
+        {
+            // About half of the books are on the shelf, in either spelling
+            int count = reservation_dist(rand_gen) - 4;
+            reservations = count > 0 ? to_string(count) : (count % 2 == 0 ? "on-the-shelf" : "0");
+        }
+
+        buffer += "Library";
+        buffer += to_string(library_dist(rand_gen));
+        buffer += delimiter;
+        buffer += "Writer";
+        buffer += to_string(author);
+        buffer += delimiter;
+        buffer += title_of(author, title_dist(rand_gen));
+        buffer += delimiter;
+        buffer += reservations;
+        buffer += '\n';
+
+        if (buffer.size() >= (1 << 20) - 256)
+        {
+            out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+}
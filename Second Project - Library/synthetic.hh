@@ -0,0 +1,42 @@
+/* Library Management System
+ * The purpose of this header file is to declare the generator of
+ * synthetic library input files used for benchmarking. The files use
+ * the same format the program reads: library, author, title and
+ * reservations separated by ';' or ','.
+ * */
+
+#ifndef SYNTHETIC_HH
+#define SYNTHETIC_HH
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+struct GeneratorOptions
+{
+    std::uint64_t rows = 1000;
+    std::uint32_t libraries = 20;
+    std::uint32_t authors = 1000;
+    std::uint32_t titles_per_author = 8;
+    // Zipf exponent of author popularity, 0 gives every author as many rows
+    double skew = 1.0;
+    // Share of lines separated with ',' instead of ';'
+    double comma_share = 0.5;
+    // Share of books with 100 reservations, which are not reservable
+    double unreservable_share = 0.02;
+    std::uint32_t seed = 1;
+};
+
+// Declare a function for setting one generator option from its command
+// line name, such as "--rows". Returns false for an unknown name or an
+// invalid value.
+bool set_generator_option(const std::string &name, const std::string &value,
+                          GeneratorOptions &options);
+
+// Declare a function for the command line help of the generator options.
+std::string generator_usage();
+
+// Declare a function for writing a synthetic input file.
+void generate_catalog(const GeneratorOptions &options, std::ostream &out);
+
+#endif // SYNTHETIC_HH
@@ -0,0 +1,72 @@
+#!/bin/sh
+# Golden output tests of the library program. Every test runs the
+# program on tests/library.csv and compares what it prints with the
+# expected output checked in next to this script:
+#
+# - commands: every command, including wrong ones, run as a script;
+#   also writes a snapshot and a reservation log;
+# - replay:   a restart that maps the snapshot and replays the log;
+# - csv:      the same restart reading the CSV instead of the snapshot;
+# - server:   the commands answered over the socket; skipped when the
+#             client has not been built.
+#
+# Usage: run_golden.sh <library> <library_client>
+
+if [ $# -ne 2 ]; then
+    echo "Usage: $0 <library> <library_client>"
+    exit 1
+fi
+library=$1
+client=$2
+here=$(cd "$(dirname "$0")" && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+failures=0
+
+check() {
+    if diff -u "$here/$2" "$work/$3"; then
+        echo "PASS $1"
+    else
+        echo "FAIL $1"
+        failures=$((failures + 1))
+    fi
+}
+
+cp "$here/library.csv" "$work/library.csv"
+"$library" --input "$work/library.csv" --snapshot "$work/library.snap" \
+    --script "$here/commands.txt" > "$work/commands.out" 2> /dev/null
+check commands expected_commands.txt commands.out
+
+"$library" --input "$work/library.csv" --snapshot "$work/library.snap" \
+    --script "$here/replay_commands.txt" > "$work/replay.out" 2> /dev/null
+check replay expected_replay.txt replay.out
+
+"$library" --input "$work/library.csv" \
+    --script "$here/replay_commands.txt" > "$work/csv.out" 2> /dev/null
+check csv expected_replay.txt csv.out
+
+# The server closes the connection on quit, so only the commands before
+# it are sent. They produce the same output as the script.
+if [ -x "$client" ]; then
+    cp "$here/library.csv" "$work/server.csv"
+    sed '/^quit$/,$d' "$here/commands.txt" > "$work/server_commands.txt"
+    "$library" --input "$work/server.csv" --serve "$work/library.sock" --workers 2 > /dev/null &
+    server=$!
+    tries=0
+    while [ ! -S "$work/library.sock" ] && [ $tries -lt 100 ]; do
+        sleep 0.1
+        tries=$((tries + 1))
+    done
+    "$client" "$work/library.sock" --print "$work/server_commands.txt" > "$work/server.out"
+    kill -TERM $server
+    wait $server
+    check server expected_commands.txt server.out
+else
+    echo "SKIP server: $client not found, build library_client.pro to run it"
+fi
+
+if [ $failures -ne 0 ]; then
+    echo "$failures golden tests failed"
+    exit 1
+fi
+echo "All golden tests passed"